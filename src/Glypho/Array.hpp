@@ -0,0 +1,113 @@
+/**
+ * @file Array.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief An array that owns its items, or reads them from a mapped file
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Array class
+     * The arrays of a loaded program are built in memory, or are read in
+     * place from a compiled program (see Glyc), without copying them. The
+     * mapped items are read-only: they are copied into memory the first time
+     * the array is changed. The mapping is shared by the arrays that use it,
+     * and is removed after the last one.
+     */
+    template <typename T>
+    class Array {
+       private:
+        std::vector<T> owned;    // The items, if they are not mapped
+        std::shared_ptr<const void> mapping;    // Keeps the file mapped
+        const T* mapped;                        // The mapped items
+        size_t mapped_size;
+
+        /**
+         * @brief Copy the mapped items into memory, before a change
+         */
+        void own() {
+            if (mapping) {
+                owned.assign(mapped, mapped + mapped_size);
+                mapping.reset();
+                mapped = nullptr;
+                mapped_size = 0;
+            }
+        }
+
+       public:
+        /**
+         * @brief Construct a new Array object
+         * Empty constructor
+         */
+        Array() : mapped(nullptr), mapped_size(0) {}
+
+        /**
+         * @brief Construct a new Array object, with copies of a value
+         *
+         * @param count The number of items
+         * @param value The value
+         */
+        Array(const size_t count, const T& value)
+            : owned(count, value), mapped(nullptr), mapped_size(0) {}
+
+        /**
+         * @brief Construct a new Array object, taking the items of a vector
+         *
+         * @param items The items
+         */
+        explicit Array(std::vector<T>&& items)
+            : owned(std::move(items)), mapped(nullptr), mapped_size(0) {}
+
+        /**
+         * @brief Construct a new Array object, over mapped items
+         *
+         * @param items The first item
+         * @param count The number of items
+         * @param mapping The mapping that contains them
+         */
+        Array(const T* items, const size_t count,
+              const std::shared_ptr<const void>& mapping)
+            : mapping(mapping), mapped(items), mapped_size(count) {}
+
+        size_t size() const { return mapping ? mapped_size : owned.size(); }
+
+        const T* data() const { return mapping ? mapped : owned.data(); }
+
+        const T& operator[](const size_t index) const { return data()[index]; }
+
+        const T& back() const { return data()[size() - 1]; }
+
+        // The changes work on the items in memory
+        T& operator[](const size_t index) {
+            own();
+            return owned[index];
+        }
+
+        T& back() {
+            own();
+            return owned.back();
+        }
+
+        void push_back(const T& value) {
+            own();
+            owned.push_back(value);
+        }
+
+        void reserve(const size_t count) {
+            own();
+            owned.reserve(count);
+        }
+
+        void assign(const size_t count, const T& value) {
+            mapping.reset();
+            mapped = nullptr;
+            mapped_size = 0;
+            owned.assign(count, value);
+        }
+    };
+}    // namespace Glypho::Core
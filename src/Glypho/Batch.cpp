@@ -0,0 +1,201 @@
+/**
+ * @file Batch.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Batch runner
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Batch.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+
+#include "IO.hpp"
+#include "ThreadPool.hpp"
+
+using namespace Glypho;
+
+namespace {
+    /**
+     * @brief A program used by the jobs, loaded once
+     */
+    struct LoadedProgram {
+        std::unique_ptr<Interpreter> interpreter;    // Null if it failed
+        std::string error;                           // Why it failed
+        int exit_code;
+    };
+
+    /**
+     * @brief Get the name of a file, without its directory and extension
+     *
+     * @param path The path of the file
+     * @return std::string The name
+     */
+    std::string stem(const std::string& path) {
+        size_t start = path.find_last_of('/');
+        start = (start == std::string::npos) ? 0 : start + 1;
+
+        size_t end = path.find_last_of('.');
+        if (end == std::string::npos || end < start) { end = path.size(); }
+
+        return path.substr(start, end - start);
+    }
+
+    /**
+     * @brief Run a job, storing its results
+     *
+     * @param job The job
+     * @param program The program of the job
+     */
+    void run_job(Job* job, const LoadedProgram& program) {
+        // The errors found when the program was loaded
+        if (program.interpreter == nullptr) {
+            job->error = program.error;
+            job->exit_code = program.exit_code;
+            return;
+        }
+
+        int input = open(job->input.c_str(), O_RDONLY);
+        if (input < 0) {
+            job->error = "ArgumentError: Couldn't read the input '" +
+                         job->input + "'\n";
+            job->exit_code = -1;
+            return;
+        }
+
+        job->exit_code = 0;
+        try {
+            IO::Redirect redirect(input, &job->output);
+            program.interpreter->run_shared(job->base);
+        } catch (const Throwable::Failure& failure) {
+            job->error = failure.what();
+            job->exit_code = failure.exit_code();
+        } catch (const std::exception& exception) {
+            // Any other error (like no memory for a large number) only stops
+            // this job
+            job->error = std::string("Error: ") + exception.what() + "\n";
+            job->exit_code = -1;
+        }
+        close(input);
+    }
+
+    /**
+     * @brief Write a results file
+     *
+     * @param path The path of the file
+     * @param content The content of the file
+     */
+    void write_file(const std::string& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+}    // namespace
+
+Batch::Batch(const std::string& manifest, const Engine engine,
+             const int level)
+    : engine(engine), optimization_level(level) {
+    std::ifstream file(manifest);
+    Helpers::MUST(file.is_open(),
+                  "ArgumentError: Couldn't read the manifest '" + manifest +
+                      "'\n");
+
+    std::set<std::string> names;
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); ++number) {
+        std::istringstream fields(line);
+        std::string program, input, base, extra;
+
+        fields >> program;
+        if (program.empty() || program[0] == '#') { continue; }
+        fields >> input >> base >> extra;
+
+        std::string where = " (line " + std::to_string(number) + ")\n";
+        Helpers::MUST(!input.empty() && extra.empty(),
+                      "ArgumentError: Invalid job in the manifest" + where);
+
+        Job job;
+        job.program = program;
+        job.input = input;
+        job.base = Constants::DEFAULT_INPUT_BASE;
+        job.exit_code = 0;
+
+        // The same checks as for the base of a single program
+        if (!base.empty()) {
+            int value = 0;
+            try {
+                value = std::stoi(base);
+            } catch (std::exception& e) {
+                Helpers::MUST(false, "ArgumentError: Base '" + base +
+                                         "' is not a number" + where);
+            }
+            Helpers::MUST(value > 1, "ArgumentError: Base '" + base +
+                                         "' is not a valid number" + where);
+            job.base = value;
+        }
+
+        // The jobs with the same input file get different names
+        job.name = stem(input);
+        if (!names.insert(job.name).second) {
+            job.name += "-" + std::to_string(number);
+            names.insert(job.name);
+        }
+
+        jobs.push_back(job);
+    }
+}
+
+void Batch::run(const std::string& directory) {
+    struct stat info;
+    mkdir(directory.c_str(), 0777);
+    Helpers::MUST(stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode),
+                  "ArgumentError: Couldn't create the results directory '" +
+                      directory + "'\n");
+
+    // Every program is loaded once. The map doesn't change while the jobs
+    // run, so they can search it at the same time.
+    std::map<std::string, LoadedProgram> programs;
+    for (auto& job : jobs) { programs[job.program]; }
+
+    std::vector<std::pair<const std::string, LoadedProgram>*> loading;
+    for (auto& program : programs) { loading.push_back(&program); }
+
+    Core::ThreadPool& pool = Core::ThreadPool::instance();
+    pool.run(loading.size(), [&](size_t index) {
+        const std::string& path = loading[index]->first;
+        LoadedProgram& program = loading[index]->second;
+
+        try {
+            auto interpreter = std::make_unique<Interpreter>(path);
+            interpreter->set_engine(engine);
+            interpreter->set_optimization_level(optimization_level);
+            interpreter->load_program();
+            program.interpreter = std::move(interpreter);
+        } catch (const Throwable::Failure& failure) {
+            program.error = failure.what();
+            program.exit_code = failure.exit_code();
+        } catch (const std::exception& exception) {
+            program.error = std::string("Error: ") + exception.what() + "\n";
+            program.exit_code = -1;
+        }
+    });
+
+    pool.run(jobs.size(), [&](size_t index) {
+        Job& job = jobs[index];
+        run_job(&job, programs.find(job.program)->second);
+
+        std::string prefix = directory + "/" + job.name;
+        write_file(prefix + ".out", job.output);
+        write_file(prefix + ".err", job.error);
+        write_file(prefix + ".ret",
+                   std::to_string(job.exit_code & 0xFF) + "\n");
+    });
+}
+
+const std::vector<Job>& Batch::get_jobs() const { return jobs; }
@@ -0,0 +1,72 @@
+/**
+ * @file Batch.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Runs many programs (each with its own input and base) in the same
+ * process, writing the results like the tests of the checker
+ * @copyright Copyright (c) 2020
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Interpreter.hpp"
+
+namespace Glypho {
+    /**
+     * @brief A program run of a batch, and its results
+     */
+    struct Job {
+        std::string program;    // The path of the program
+        std::string input;      // The path of the file with the input
+        unsigned int base;      // The base of the input numbers
+        std::string name;       // The name of the result files
+        std::string output;     // What the program wrote to stdout
+        std::string error;      // What the program wrote to stderr
+        int exit_code;
+    };
+
+    /**
+     * @brief Declaration for the Batch class
+     * The manifest has a job on each line: the program, the input file and,
+     * optionally, the base (empty lines and the ones starting with # are
+     * ignored). Every program is loaded (and optimized) once, even if it is
+     * used by multiple jobs, and the loaded programs are shared by the jobs,
+     * which run in parallel on the ThreadPool, each with its I/O redirected.
+     * The results of a job are written in the results directory, named after
+     * its input file: <name>.out (stdout), <name>.err (stderr) and <name>.ret
+     * (the exit code, as the shell reports it), like in checker/tests.
+     */
+    class Batch {
+       private:
+        std::vector<Job> jobs;
+        Engine engine;
+        int optimization_level;
+
+       public:
+        /**
+         * @brief Read the jobs of a batch
+         *
+         * @param manifest The path of the manifest
+         * @param engine The engine the programs are run with
+         * @param level The optimization level
+         */
+        Batch(const std::string& manifest, const Engine engine,
+              const int level);
+
+        /**
+         * @brief Run all the jobs, and write their results
+         *
+         * @param directory The results directory (created if needed)
+         */
+        void run(const std::string& directory);
+
+        /**
+         * @brief Get the jobs, with their results
+         *
+         * @return const std::vector<Job>& The jobs, in the manifest order
+         */
+        const std::vector<Job>& get_jobs() const;
+    };
+}    // namespace Glypho
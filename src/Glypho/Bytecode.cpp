@@ -0,0 +1,378 @@
+/**
+ * @file Bytecode.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Bytecode and its dispatch loop
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Bytecode.hpp"
+
+#include "Diagnostics.hpp"
+#include "Loops.hpp"
+#include "TopCache.hpp"
+
+// Direct-threaded dispatch uses the "labels as values" GNU extension. Other
+// compilers fall back to a switch-based loop.
+#if defined(__GNUC__)
+#define GLYPHO_THREADED_DISPATCH 1
+#else
+#define GLYPHO_THREADED_DISPATCH 0
+#endif
+
+using namespace Glypho::Core;
+
+Bytecode::Bytecode()
+    : code(1, (uint8_t)Opcode::Halt),
+      argument(1, 0),
+      source_id(1, 0),
+      safe(1, 0),
+      entry(0) {}
+
+Bytecode::Bytecode(const Program& program) : Bytecode() {
+    Program::Index program_size = program.size();
+    code.reserve(program_size + 1);
+    argument.reserve(program_size + 1);
+    source_id.reserve(program_size + 1);
+
+    for (Program::Index id = 0; id < program_size; ++id) {
+        InstructionType type = program.type_at(id);
+
+        switch (type) {
+            case InstructionType::LBrace: {
+                // Skip over the matching brace, its check would have the
+                // same result
+                append(Opcode::LBrace, (int64_t)program.jump_at(id) + 1, id);
+            } break;
+            case InstructionType::RBrace: {
+                // The errors are reported for the associated L-brace
+                Program::Index block_start = program.jump_at(id);
+                append(Opcode::RBrace, (int64_t)block_start + 1, block_start);
+            } break;
+            default: {
+                append((Opcode)type, (int64_t)id + 1, id);
+            } break;
+        }
+    }
+}
+
+long int Bytecode::size() const { return code.size() - 1; }
+
+Opcode Bytecode::opcode_at(const long int pc) const { return (Opcode)code[pc]; }
+
+int64_t Bytecode::argument_at(const long int pc) const {
+    return argument[pc];
+}
+
+uint32_t Bytecode::source_at(const long int pc) const {
+    return source_id[pc];
+}
+
+void Bytecode::append(const Opcode opcode, const int64_t arg,
+                      const uint32_t source) {
+    // The last position is always the Halt, so it is moved after the new
+    // opcode
+    code.back() = (uint8_t)opcode;
+    argument.back() = arg;
+    source_id.back() = source;
+    safe.back() = 0;
+
+    code.push_back((uint8_t)Opcode::Halt);
+    argument.push_back(0);
+    source_id.push_back(source);
+    safe.push_back(0);
+}
+
+const LoopInfo& Bytecode::loop_at(const long int index) const {
+    return loops[index];
+}
+
+long int Bytecode::loop_count() const { return loops.size(); }
+
+long int Bytecode::add_loop(const LoopInfo& loop) {
+    loops.push_back(loop);
+    return loops.size() - 1;
+}
+
+void Bytecode::set_opcode(const long int pc, const Opcode opcode,
+                          const int64_t arg) {
+    code[pc] = (uint8_t)opcode;
+    argument[pc] = arg;
+}
+
+void Bytecode::set_argument(const long int pc, const int64_t arg) {
+    argument[pc] = arg;
+}
+
+bool Bytecode::is_safe(const long int pc) const { return safe[pc] != 0; }
+
+void Bytecode::set_safe(const long int pc, const bool value) {
+    safe[pc] = value;
+}
+
+long int Bytecode::entry_point() const { return entry; }
+
+void Bytecode::set_entry_point(const long int pc) { entry = pc; }
+
+template <typename Top>
+void Bytecode::dispatch(Stack* glypho_stack, const int base) const {
+    const uint8_t* ops = code.data();
+    const int64_t* args = argument.data();
+    const uint32_t* ids = source_id.data();
+    uint32_t pc = entry;
+    Top stack(glypho_stack);
+
+    // The compiled loops, for each stack size they were entered with
+    std::vector<LoopKernels> kernels(loops.size());
+
+#if GLYPHO_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    // Same order as the Opcode enum
+    static const void* const labels[] = {
+        &&op_nop,        &&op_input,    &&op_rot,      &&op_swap,
+        &&op_push,       &&op_rrot,     &&op_dup,      &&op_add,
+        &&op_lbrace,     &&op_output,   &&op_multiply, &&op_execute,
+        &&op_negate,     &&op_pop,      &&op_rbrace,   &&op_halt,
+        &&op_push_const, &&op_add_const, &&op_rot_n,   &&op_dup_lbrace,
+        &&op_loop,       &&op_raise};
+
+    // The handlers of the safe opcodes, without the stack checks
+    static const void* const unchecked_labels[] = {
+        &&op_nop,
+        &&op_input,
+        &&op_rot_unchecked,
+        &&op_swap_unchecked,
+        &&op_push,
+        &&op_rrot_unchecked,
+        &&op_dup_unchecked,
+        &&op_add_unchecked,
+        &&op_lbrace_unchecked,
+        &&op_output_unchecked,
+        &&op_multiply_unchecked,
+        &&op_execute,
+        &&op_negate_unchecked,
+        &&op_pop_unchecked,
+        &&op_rbrace_unchecked,
+        &&op_halt,
+        &&op_push_const,
+        &&op_add_const_unchecked,
+        &&op_rot_n_unchecked,
+        &&op_dup_lbrace_unchecked,
+        &&op_loop_unchecked,
+        &&op_raise};
+
+    // Direct threading: every opcode is replaced by the address of its handler
+    std::vector<const void*> threaded(code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        threaded[i] = safe[i] ? unchecked_labels[ops[i]] : labels[ops[i]];
+    }
+    const void* const* handlers = threaded.data();
+
+#define CASE(label, opcode) label:
+#define NEXT() goto* handlers[++pc]
+#define JUMP(destination)     \
+    do {                      \
+        pc = (destination);   \
+        goto* handlers[pc];   \
+    } while (0)
+
+    goto* handlers[pc];
+#else
+#define CASE(label, opcode) case Opcode::opcode:
+#define NEXT() \
+    ++pc;      \
+    continue
+#define JUMP(destination) \
+    pc = (destination);   \
+    continue
+
+    while (true) {
+        switch ((Opcode)ops[pc]) {
+#endif
+
+    CASE(op_nop, NOP) { NEXT(); }
+    CASE(op_input, Input) {
+        stack.Input(Helpers::readNumber(base, ids[pc]));
+        NEXT();
+    }
+    CASE(op_rot, Rot) {
+        stack.Rotate(ids[pc]);
+        NEXT();
+    }
+    CASE(op_swap, Swap) {
+        stack.Swap(ids[pc]);
+        NEXT();
+    }
+    CASE(op_push, Push) {
+        stack.Push();
+        NEXT();
+    }
+    CASE(op_rrot, RRot) {
+        stack.ReverseRotate(ids[pc]);
+        NEXT();
+    }
+    CASE(op_dup, Dup) {
+        stack.Dup(ids[pc]);
+        NEXT();
+    }
+    CASE(op_add, Add) {
+        stack.Add(ids[pc]);
+        NEXT();
+    }
+    CASE(op_lbrace, LBrace) {
+        if (stack.TopIsZero(ids[pc])) { JUMP(args[pc]); }
+        NEXT();
+    }
+    CASE(op_output, Output) {
+        Helpers::printNumber(base, stack.Output(ids[pc]));
+        NEXT();
+    }
+    CASE(op_multiply, Multiply) {
+        stack.Multiply(ids[pc]);
+        NEXT();
+    }
+    CASE(op_execute, Execute) {
+        // All the errors are reported using the id of the execute
+        execute_generated(stack.spill(), ids[pc], base);
+        stack.load();
+        NEXT();
+    }
+    CASE(op_negate, Negate) {
+        stack.Negate(ids[pc]);
+        NEXT();
+    }
+    CASE(op_pop, Pop) {
+        stack.Pop(ids[pc]);
+        NEXT();
+    }
+    CASE(op_rbrace, RBrace) {
+        if (!stack.TopIsZero(ids[pc])) { JUMP(args[pc]); }
+        NEXT();
+    }
+    CASE(op_halt, Halt) { return; }
+    CASE(op_push_const, PushConst) {
+        stack.PushConstant(args[pc]);
+        NEXT();
+    }
+    CASE(op_add_const, AddConst) {
+        stack.AddConstant(args[pc], ids[pc]);
+        NEXT();
+    }
+    CASE(op_rot_n, RotN) {
+        stack.RotateBy(args[pc], ids[pc]);
+        NEXT();
+    }
+    CASE(op_dup_lbrace, DupLBrace) {
+        stack.Dup(ids[pc]);
+        if (stack.TopIsZero(ids[pc])) { JUMP(args[pc]); }
+        NEXT();
+    }
+    CASE(op_loop, Loop) {
+        const LoopInfo& loop = loops[args[pc]];
+        if (stack.TopIsZero(ids[pc])) { JUMP(loop.exit); }
+
+        // Run the whole loop natively, if possible. If the kernel stops
+        // early (an overflow), the remaining iterations are interpreted.
+        Stack* whole = stack.spill();
+        const LoopKernel& kernel =
+            kernels[args[pc]].get(*this, loop, whole->Size());
+        bool finished = kernel.run(whole);
+        stack.load();
+        if (finished) { JUMP(loop.exit); }
+        JUMP(loop.body);
+    }
+    CASE(op_raise, Raise) {
+        Diagnostics::raise(Throwable::RuntimeException(args[pc]), ids[pc]);
+    }
+
+#if GLYPHO_THREADED_DISPATCH
+    // The same handlers, for the safe opcodes. The switch-based loop always
+    // runs the checked ones.
+    CASE(op_rot_unchecked, Rot) {
+        stack.template Rotate<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_swap_unchecked, Swap) {
+        stack.template Swap<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_rrot_unchecked, RRot) {
+        stack.template ReverseRotate<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_dup_unchecked, Dup) {
+        stack.template Dup<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_add_unchecked, Add) {
+        stack.template Add<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_lbrace_unchecked, LBrace) {
+        if (stack.template TopIsZero<false>(ids[pc])) { JUMP(args[pc]); }
+        NEXT();
+    }
+    CASE(op_output_unchecked, Output) {
+        Helpers::printNumber(base, stack.template Output<false>(ids[pc]));
+        NEXT();
+    }
+    CASE(op_multiply_unchecked, Multiply) {
+        stack.template Multiply<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_negate_unchecked, Negate) {
+        stack.template Negate<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_pop_unchecked, Pop) {
+        stack.template Pop<false>(ids[pc]);
+        NEXT();
+    }
+    CASE(op_rbrace_unchecked, RBrace) {
+        if (!stack.template TopIsZero<false>(ids[pc])) { JUMP(args[pc]); }
+        NEXT();
+    }
+    CASE(op_add_const_unchecked, AddConst) {
+        stack.template AddConstant<false>(args[pc], ids[pc]);
+        NEXT();
+    }
+    CASE(op_rot_n_unchecked, RotN) {
+        stack.template RotateBy<false>(args[pc], ids[pc]);
+        NEXT();
+    }
+    CASE(op_dup_lbrace_unchecked, DupLBrace) {
+        stack.template Dup<false>(ids[pc]);
+        if (stack.template TopIsZero<false>(ids[pc])) { JUMP(args[pc]); }
+        NEXT();
+    }
+    CASE(op_loop_unchecked, Loop) {
+        const LoopInfo& loop = loops[args[pc]];
+        if (stack.template TopIsZero<false>(ids[pc])) { JUMP(loop.exit); }
+
+        Stack* whole = stack.spill();
+        const LoopKernel& kernel =
+            kernels[args[pc]].get(*this, loop, whole->Size());
+        bool finished = kernel.run(whole);
+        stack.load();
+        if (finished) { JUMP(loop.exit); }
+        JUMP(loop.body);
+    }
+
+#pragma GCC diagnostic pop
+#else
+        }
+    }
+#endif
+
+#undef CASE
+#undef NEXT
+#undef JUMP
+}
+
+void Bytecode::run(Stack* glypho_stack, const int base) const {
+    dispatch<NoCache>(glypho_stack, base);
+}
+
+void Bytecode::run_cached(Stack* glypho_stack, const int base) const {
+    dispatch<TopCache>(glypho_stack, base);
+}
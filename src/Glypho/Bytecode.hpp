@@ -0,0 +1,238 @@
+/**
+ * @file Bytecode.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Compact bytecode representation of a Glypho program, and the
+ * threaded-dispatch engine that runs it
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Array.hpp"
+#include "Helpers.hpp"
+#include "Instruction.hpp"
+#include "Program.hpp"
+#include "Stack.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief The opcodes of the bytecode. The first 15 values are the same as
+     * the ones in InstructionType, so a conversion is a simple cast.
+     */
+    enum class Opcode : uint8_t {
+        NOP,
+        Input,
+        Rot,
+        Swap,
+        Push,
+        RRot,
+        Dup,
+        Add,
+        LBrace,
+        Output,
+        Multiply,
+        Execute,
+        Negate,
+        Pop,
+        RBrace,
+        Halt,         // Marks the end of the program
+        PushConst,    // Pushes the argument (folded pushes, adds, etc.)
+        AddConst,     // Adds the argument to the top element
+        RotN,         // Rotates the stack argument times (negative for RRot)
+        DupLBrace,    // A Dup followed by a L-brace
+        Loop,         // A L-brace whose loop can be run by a LoopKernel
+        Raise         // Stops the program with the exception in the argument
+    };
+
+    /**
+     * @brief A loop whose body only changes the stack (no I/O, executes or
+     * other loops)
+     */
+    struct LoopInfo {
+        int64_t body;    // The position of the first opcode of the body
+        int64_t exit;    // The position after the R-brace
+    };
+
+    /**
+     * @brief Declaration for the Bytecode class
+     * The linked instruction list is lowered into a dense array of 1-byte
+     * opcodes. The braces have their jump targets pre-resolved: an L-brace
+     * jumps directly after its R-brace, and an R-brace jumps directly after
+     * its L-brace (the stack does not change between the two, so the result
+     * of the second check is already known).
+     * Each opcode also stores the id of the source instruction it reports
+     * errors for, so the bytecode can be rewritten by optimization passes.
+     * The opcodes whose stack checks can never fail are marked as safe, and
+     * run without them. If the start of the program was evaluated when it
+     * was loaded, the run starts from the entry point instead of the first
+     * opcode. The arrays can also be mapped from a compiled program.
+     */
+    class Bytecode {
+       private:
+        Array<uint8_t> code;          // The opcodes, ending with a Halt
+        Array<int64_t> argument;      // The jump target or constant
+        Array<uint32_t> source_id;    // The id used for errors
+        Array<LoopInfo> loops;        // The loops used by Loop opcodes
+        Array<uint8_t> safe;    // If the stack checks can never fail
+        long int entry;         // Where the run starts
+
+        friend class Glyc;    // Saves and maps the arrays
+
+        /**
+         * @brief Run the bytecode, starting from the entry point
+         *
+         * @tparam Top The way the stack is accessed (NoCache or TopCache)
+         * @param glypho_stack The glypho stack the program uses
+         * @param base The base of the numbers that can be read from stdin
+         */
+        template <typename Top>
+        void dispatch(Stack* glypho_stack, const int base) const;
+
+       public:
+        /**
+         * @brief Construct a new Bytecode object
+         * Empty constructor
+         */
+        Bytecode();
+
+        /**
+         * @brief Lower a linked program into bytecode
+         *
+         * @param program The program, after linking
+         */
+        explicit Bytecode(const Program& program);
+
+        /**
+         * @brief Get the number of opcodes (without the final Halt)
+         *
+         * @return long int The size
+         */
+        long int size() const;
+
+        /**
+         * @brief Get the opcode at the specified position
+         *
+         * @param pc The position
+         * @return Opcode The opcode
+         */
+        Opcode opcode_at(const long int pc) const;
+
+        /**
+         * @brief Get the argument of the opcode at the specified position
+         *
+         * @param pc The position
+         * @return int64_t The jump target (braces) or constant
+         */
+        int64_t argument_at(const long int pc) const;
+
+        /**
+         * @brief Get the id of the source instruction of the opcode at the
+         * specified position (the id used to report errors)
+         *
+         * @param pc The position
+         * @return uint32_t The id
+         */
+        uint32_t source_at(const long int pc) const;
+
+        /**
+         * @brief Add an opcode at the end of the bytecode (before the Halt)
+         *
+         * @param opcode The opcode
+         * @param arg The jump target or constant
+         * @param source The id of the source instruction
+         */
+        void append(const Opcode opcode, const int64_t arg,
+                    const uint32_t source);
+
+        /**
+         * @brief Get the loop with the specified index
+         *
+         * @param index The index (the argument of a Loop opcode)
+         * @return const LoopInfo& The loop
+         */
+        const LoopInfo& loop_at(const long int index) const;
+
+        /**
+         * @brief Get the number of loops used by Loop opcodes
+         *
+         * @return long int The number of loops
+         */
+        long int loop_count() const;
+
+        /**
+         * @brief Add a loop to the bytecode
+         *
+         * @param loop The loop
+         * @return long int The index of the loop
+         */
+        long int add_loop(const LoopInfo& loop);
+
+        /**
+         * @brief Change an opcode, keeping its source id
+         *
+         * @param pc The position of the opcode
+         * @param opcode The new opcode
+         * @param arg The new argument
+         */
+        void set_opcode(const long int pc, const Opcode opcode,
+                        const int64_t arg);
+
+        /**
+         * @brief Change the argument of an opcode (used to fix jump targets)
+         *
+         * @param pc The position of the opcode
+         * @param arg The new argument
+         */
+        void set_argument(const long int pc, const int64_t arg);
+
+        /**
+         * @brief Check if the stack checks of an opcode can never fail
+         *
+         * @param pc The position of the opcode
+         * @return bool If the opcode can run unchecked
+         */
+        bool is_safe(const long int pc) const;
+
+        /**
+         * @brief Mark an opcode as safe (or not). A new opcode is not safe.
+         *
+         * @param pc The position of the opcode
+         * @param value If the stack checks of the opcode can never fail
+         */
+        void set_safe(const long int pc, const bool value);
+
+        /**
+         * @brief Get the position where the run starts
+         *
+         * @return long int The entry point (0, if nothing was evaluated)
+         */
+        long int entry_point() const;
+
+        /**
+         * @brief Set the position where the run starts. The stack must be in
+         * the state the program has when it reaches that opcode.
+         *
+         * @param pc The entry point
+         */
+        void set_entry_point(const long int pc);
+
+        /**
+         * @brief Run the bytecode, starting from the entry point
+         *
+         * @param glypho_stack The glypho stack the program uses
+         * @param base The base of the numbers that can be read from stdin
+         */
+        void run(Stack* glypho_stack, const int base) const;
+
+        /**
+         * @brief Run the bytecode, starting from the entry point, keeping the
+         * top of the stack in a local variable (see TopCache)
+         *
+         * @param glypho_stack The glypho stack the program uses
+         * @param base The base of the numbers that can be read from stdin
+         */
+        void run_cached(Stack* glypho_stack, const int base) const;
+    };
+}    // namespace Glypho::Core
@@ -0,0 +1,30 @@
+/**
+ * @file Diagnostics.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the cold error paths
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Diagnostics.hpp"
+
+#include "IO.hpp"
+
+using namespace Glypho;
+
+void Diagnostics::raise(Throwable::SyntaxError error, const long int id) {
+    throw Throwable::Failure(Throwable::message(error, id) + "\n", -1,
+                             Throwable::Category::Syntax, (int)error, id);
+}
+
+void Diagnostics::raise(Throwable::RuntimeException exception,
+                        const long int id) {
+    throw Throwable::Failure(Throwable::message(exception, id) + "\n", -2,
+                             Throwable::Category::Runtime, (int)exception, id);
+}
+
+int Diagnostics::report(const Throwable::Failure& failure) {
+    // The output of the program comes before the error
+    IO::flush();
+    std::cerr << failure.what();
+    return failure.exit_code();
+}
@@ -0,0 +1,76 @@
+/**
+ * @file Diagnostics.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Error checks used on the hot paths of the interpreter. A check only
+ * carries the error type and the instruction id, the message is built (and
+ * the program stopped) in a cold function, only if the check fails.
+ * @copyright Copyright (c) 2020
+ */
+
+#pragma once
+
+#include "Helpers.hpp"
+
+#if defined(__GNUC__)
+#define GLYPHO_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define GLYPHO_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#define GLYPHO_COLD __attribute__((noinline, cold))
+#else
+#define GLYPHO_LIKELY(condition) (condition)
+#define GLYPHO_UNLIKELY(condition) (condition)
+#define GLYPHO_COLD
+#endif
+
+namespace Glypho::Diagnostics {
+    /**
+     * @brief Stop the program with a SyntaxError (exit code -1)
+     *
+     * @param error The SyntaxError
+     * @param id The id of the instruction that caused the error
+     */
+    [[noreturn]] GLYPHO_COLD void raise(Throwable::SyntaxError error,
+                                        const long int id);
+
+    /**
+     * @brief Stop the program with a RuntimeException (exit code -2)
+     *
+     * @param exception The RuntimeException
+     * @param id The id of the instruction that caused the exception
+     */
+    [[noreturn]] GLYPHO_COLD void raise(Throwable::RuntimeException exception,
+                                        const long int id);
+
+    /**
+     * @brief Report an error that stopped the program: the output written so
+     * far is flushed, and the message is printed to stderr
+     *
+     * @param failure The error
+     * @return int The exit code of the program
+     */
+    int report(const Throwable::Failure& failure);
+
+    /**
+     * @brief Check if the condition is triggered. If it is not, raise the
+     * error
+     *
+     * @param condition The condition that must happen
+     * @param error The error (SyntaxError or RuntimeException)
+     * @param id The id of the instruction that is checked
+     */
+    template <typename Error>
+    inline void MUST(bool condition, Error error, const long int id) {
+        if (GLYPHO_UNLIKELY(!condition)) { raise(error, id); }
+    }
+
+    /**
+     * @brief Check if the condition is triggered. If it is, raise the error
+     *
+     * @param condition The condition that must not happen
+     * @param error The error (SyntaxError or RuntimeException)
+     * @param id The id of the instruction that is checked
+     */
+    template <typename Error>
+    inline void MUST_NOT(bool condition, Error error, const long int id) {
+        if (GLYPHO_UNLIKELY(condition)) { raise(error, id); }
+    }
+}    // namespace Glypho::Diagnostics
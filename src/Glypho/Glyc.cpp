@@ -0,0 +1,268 @@
+/**
+ * @file Glyc.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the compiled programs
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Glyc.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+using namespace Glypho::Core;
+
+namespace {
+    // Only the "G", "L", "Y" and "C" would be code in a source file, the
+    // other bytes are skipped, so sources don't start like this
+    const char MAGIC[8] = {'\x7f', 'G', 'L', 'Y', 'C', '\r', '\n', '\x1a'};
+
+    const uint64_t CHECKSUM_SEED = 0xCBF29CE484222325ULL;
+    const uint64_t CHECKSUM_PRIME = 0x100000001B3ULL;
+
+    /**
+     * @brief The arrays of a compiled program, in the order they are stored
+     */
+    enum Section {
+        TYPES,
+        BRACE_BITS,
+        BRACE_RANK,
+        JUMPS,
+        CODE,
+        ARGUMENT,
+        SOURCE_ID,
+        SAFE,
+        LOOPS,
+        STACK,    // The numbers of the stack (base 16, from the bottom)
+        SECTION_COUNT
+    };
+
+    /**
+     * @brief Where an array is stored
+     */
+    struct SectionInfo {
+        uint64_t offset;    // From the start of the file
+        uint64_t count;     // The number of items
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        int64_t entry;    // The entry point of the bytecode
+        SectionInfo sections[SECTION_COUNT];
+        uint64_t payload_checksum;    // Of the arrays
+        uint64_t header_checksum;     // Of the bytes before it
+    };
+
+    /**
+     * @brief Add bytes to a checksum, a word at a time (the last word is
+     * padded with zeros, like the arrays in the file)
+     *
+     * @param checksum The checksum of the previous bytes
+     * @param data The bytes
+     * @param size The number of bytes
+     * @return uint64_t The new checksum
+     */
+    uint64_t mix(uint64_t checksum, const void* data, const size_t size) {
+        const char* bytes = (const char*)data;
+        size_t position = 0;
+
+        while (position < size) {
+            uint64_t word = 0;
+            std::memcpy(&word, bytes + position,
+                        std::min<size_t>(8, size - position));
+            position += 8;
+
+            checksum = (checksum ^ word) * CHECKSUM_PRIME;
+            checksum ^= checksum >> 32;
+        }
+        return checksum;
+    }
+
+    /**
+     * @brief Stop the program, because the compiled program is not valid
+     *
+     * @param condition The condition that must happen
+     */
+    void check(const bool condition) {
+        Glypho::Helpers::MUST(
+            condition, "ArgumentError: The compiled program is not valid\n");
+    }
+
+    /**
+     * @brief Get an array of a mapped file, checking that it is inside it
+     *
+     * @param header The header of the file
+     * @param section The array
+     * @param mapping The mapped file
+     * @param size The size of the file
+     * @return Array<T> The array
+     */
+    template <typename T>
+    Array<T> section(const Header& header, const Section section,
+                     const std::shared_ptr<const void>& mapping,
+                     const size_t size) {
+        const SectionInfo& info = header.sections[section];
+        check(info.offset % 8 == 0 && info.offset >= sizeof(Header) &&
+              info.offset <= size &&
+              info.count <= (size - info.offset) / sizeof(T));
+
+        const char* start = (const char*)mapping.get() + info.offset;
+        return Array<T>((const T*)start, info.count, mapping);
+    }
+}    // namespace
+
+bool Glyc::is_compiled(const std::string& path) {
+    char magic[sizeof(MAGIC)];
+    std::ifstream file(path, std::ios::binary);
+
+    return file.read(magic, sizeof(magic)) &&
+           std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void Glyc::save(const std::string& path, const Program& program,
+                const Bytecode& bytecode, Stack stack) {
+    // The numbers of the stack, from the bottom
+    std::string numbers;
+    for (uint64_t depth = stack.Size(); depth > 0; --depth) {
+        Integer value = Integer::adopt(Integer::copy(stack.Element(depth - 1)));
+        numbers += value.to_string(16) + " ";
+    }
+
+    const void* data[SECTION_COUNT] = {
+        program.types.data(),      program.brace_bits.data(),
+        program.brace_rank.data(), program.jumps.data(),
+        bytecode.code.data(),      bytecode.argument.data(),
+        bytecode.source_id.data(), bytecode.safe.data(),
+        bytecode.loops.data(),     numbers.data()};
+    uint64_t counts[SECTION_COUNT] = {
+        program.types.size(),      program.brace_bits.size(),
+        program.brace_rank.size(), program.jumps.size(),
+        bytecode.code.size(),      bytecode.argument.size(),
+        bytecode.source_id.size(), bytecode.safe.size(),
+        bytecode.loops.size(),     numbers.size()};
+    uint64_t item_sizes[SECTION_COUNT] = {
+        sizeof(InstructionType), sizeof(uint64_t), sizeof(Program::Index),
+        sizeof(Program::Index),  sizeof(uint8_t),  sizeof(int64_t),
+        sizeof(uint32_t),        sizeof(uint8_t),  sizeof(LoopInfo),
+        sizeof(char)};
+
+    // The arrays follow the header, each one padded to 8 bytes
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entry = bytecode.entry;
+    header.payload_checksum = CHECKSUM_SEED;
+
+    uint64_t offset = sizeof(Header);
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        uint64_t bytes = counts[i] * item_sizes[i];
+        header.sections[i] = {offset, counts[i]};
+        header.payload_checksum = mix(header.payload_checksum, data[i], bytes);
+        offset += (bytes + 7) / 8 * 8;
+    }
+    header.header_checksum =
+        mix(CHECKSUM_SEED, &header, offsetof(Header, header_checksum));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        uint64_t bytes = counts[i] * item_sizes[i];
+        const char padding[8] = {};
+
+        file.write((const char*)data[i], bytes);
+        file.write(padding, (8 - bytes % 8) % 8);
+    }
+
+    Helpers::MUST(file.good(),
+                  "ArgumentError: Can not write '" + path + "'\n");
+}
+
+void Glyc::load(const std::string& path, Program* program,
+                Bytecode* bytecode, Stack* stack) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    Helpers::MUST_NOT(
+        descriptor < 0,
+        "ArgumentError: Couldn't find or open the specified file\n");
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(descriptor, &info) == 0 &&
+        (size_t)info.st_size >= sizeof(Header)) {
+        mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                      descriptor, 0);
+    }
+    close(descriptor);
+    check(mapped != MAP_FAILED);
+
+    // The arrays keep the file mapped, while they use it
+    size_t size = info.st_size;
+    std::shared_ptr<const void> mapping(
+        mapped, [size](const void* data) { munmap((void*)data, size); });
+    const Header& header = *(const Header*)mapped;
+
+    check(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0);
+    Helpers::MUST(header.version == VERSION,
+                  "ArgumentError: The compiled program has version " +
+                      std::to_string(header.version) + ", expected " +
+                      std::to_string(VERSION) + "\n");
+    check(header.header_checksum ==
+          mix(CHECKSUM_SEED, &header, offsetof(Header, header_checksum)));
+    check(header.payload_checksum ==
+          mix(CHECKSUM_SEED, (const char*)mapped + sizeof(Header),
+              size - sizeof(Header)));
+
+    Program loaded;
+    loaded.types = section<InstructionType>(header, TYPES, mapping, size);
+    loaded.brace_bits = section<uint64_t>(header, BRACE_BITS, mapping, size);
+    loaded.brace_rank =
+        section<Program::Index>(header, BRACE_RANK, mapping, size);
+    loaded.jumps = section<Program::Index>(header, JUMPS, mapping, size);
+
+    // The arrays must have the sizes the program expects
+    uint64_t words = (loaded.types.size() + 63) / 64;
+    check(loaded.types.size() < Program::END &&
+          loaded.brace_bits.size() == words &&
+          loaded.brace_rank.size() == words + 1 &&
+          loaded.jumps.size() == loaded.brace_rank[words]);
+
+    Bytecode lowered;
+    lowered.code = section<uint8_t>(header, CODE, mapping, size);
+    lowered.argument = section<int64_t>(header, ARGUMENT, mapping, size);
+    lowered.source_id = section<uint32_t>(header, SOURCE_ID, mapping, size);
+    lowered.safe = section<uint8_t>(header, SAFE, mapping, size);
+    lowered.loops = section<LoopInfo>(header, LOOPS, mapping, size);
+    lowered.entry = header.entry;
+
+    uint64_t code_size = lowered.code.size();
+    check(code_size > 0 && lowered.argument.size() == code_size &&
+          lowered.source_id.size() == code_size &&
+          lowered.safe.size() == code_size &&
+          lowered.code.back() == (uint8_t)Opcode::Halt &&
+          header.entry >= 0 && (uint64_t)header.entry < code_size);
+
+    // The stack is small, so it is parsed
+    Array<char> numbers = section<char>(header, STACK, mapping, size);
+    Stack initial;
+    for (size_t start = 0, end = 0; start < numbers.size(); start = end + 1) {
+        end = start;
+        while (end < numbers.size() && numbers[end] != ' ') { end++; }
+
+        bool valid = true;
+        initial.Input(
+            Integer::parse(numbers.data() + start, end - start, 16, &valid));
+        check(valid);
+    }
+
+    *program = std::move(loaded);
+    *bytecode = std::move(lowered);
+    *stack = std::move(initial);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file Glyc.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Glyc, the binary format of the compiled programs
+ * (.glyc), that are run without decoding, linking or optimizing them
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Bytecode.hpp"
+#include "Program.hpp"
+#include "Stack.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Glyc class
+     * A compiled program is a header, followed by the arrays of the linked
+     * Program and of its (optimized) Bytecode, and by the stack after the
+     * evaluated start of the program. Every array is aligned to 8 bytes, so
+     * the file is mapped and the arrays are used in place, without copying
+     * them. The header holds the version, the position of every array and
+     * two checksums (of the header, and of the arrays), that are checked
+     * before the program is used. The source ids are stored with the
+     * program, so the errors are the same as when the source is run.
+     * The numbers are stored in the byte order of the machine.
+     */
+    class Glyc {
+       private:
+        /**
+         * @brief Private constructor to disallow instantiation of this class
+         */
+        Glyc(){};
+
+       public:
+        static const uint32_t VERSION = 1;
+
+        /**
+         * @brief Check if a file is a compiled program (the source files
+         * can not start with the same bytes)
+         *
+         * @param path The path of the file
+         * @return bool If it is a compiled program
+         */
+        static bool is_compiled(const std::string& path);
+
+        /**
+         * @brief Write a compiled program
+         *
+         * @param path The path of the file
+         * @param program The linked program
+         * @param bytecode Its bytecode
+         * @param stack The stack the bytecode starts with
+         */
+        static void save(const std::string& path, const Program& program,
+                         const Bytecode& bytecode, Stack stack);
+
+        /**
+         * @brief Map a compiled program. The program is stopped with an
+         * ArgumentError if the file is not valid.
+         *
+         * @param path The path of the file
+         * @param program Where the linked program is stored
+         * @param bytecode Where its bytecode is stored
+         * @param stack Where the stack the bytecode starts with is stored
+         */
+        static void load(const std::string& path, Program* program,
+                         Bytecode* bytecode, Stack* stack);
+    };
+}    // namespace Glypho::Core
@@ -7,6 +7,9 @@
 
 #include "Helpers.hpp"
 
+#include "Diagnostics.hpp"
+#include "IO.hpp"
+
 using namespace Glypho;
 
 std::string Throwable::message(Throwable::SyntaxError error, const int line) {
@@ -76,45 +79,25 @@ int Helpers::numValue(const char number) {
         return (int)number - 'A' + 10;
 }
 
-std::string Helpers::switchToBase(int base, long long int inputNumber) {
-    std::string str = "";
-    bool is_negative = false;
-
-    // Convert input number is given base by repeatedly
-    // dividing it by base and taking remainder
-    if (inputNumber < 0) {
-        is_negative = true;
-        inputNumber = -inputNumber;
-    }
-
-    if (inputNumber == 0) { return "0"; };
-
-    while (inputNumber > 0) {
-        str += Helpers::charValue(inputNumber % base);
-        inputNumber /= base;
-    }
-
-    // Reverse the result
-    std::reverse(str.begin(), str.end());
-    if (is_negative) { str = "-" + str; }
-
-    return str;
+std::string Helpers::switchToBase(int base,
+                                  const Core::Integer& inputNumber) {
+    return inputNumber.to_string(base);
 }
 
-long long int Helpers::switchFromBase(int base, std::string str) {
-    int power = 1;            // Initialize power of base
-    long long int num = 0;    // Initialize result
-    bool is_negative = false;
+Core::Integer Helpers::switchFromBase(int base, std::string str, bool* valid) {
+    return Core::Integer::parse(str, base, valid);
+}
 
-    if (str.at(0) == '-') {
-        str.erase(0, 1);
-        is_negative = true;
-    }
+Core::Integer Helpers::readNumber(int base, long int id) {
+    // Parse the next token in place (it must be a number in the base)
+    bool valid;
+    Core::Integer value = IO::read_number(base, &valid);
+    Diagnostics::MUST(valid, Throwable::RuntimeException::INPUT_NOT_VALID_INT,
+                      id);
 
-    for (int i = str.length() - 1; i >= 0; i--) {
-        num += numValue(str[i]) * power;
-        power = power * base;
-    }
+    return value;
+}
 
-    return (is_negative) ? -num : num;
-}
\ No newline at end of file
+void Helpers::printNumber(int base, const Core::Integer& number) {
+    IO::write_number(base, number);
+}
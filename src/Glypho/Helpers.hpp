@@ -8,40 +8,165 @@
 #pragma once
 
 #include <algorithm>
+#include <exception>
 #include <iostream>
+#include <string>
+
+#include "Integer.hpp"
 
 namespace Glypho {
     namespace Constants {
         const unsigned int DEFAULT_INPUT_BASE = 10;
+        const int DEFAULT_OPTIMIZATION_LEVEL = 2;
     }
 
+    namespace Throwable {
+        /**
+         * @brief Types of SyntaxErrors the Glypho interpreter can throw
+         *
+         */
+        enum class SyntaxError {
+            CODE_LENGTH_INVALID,    // The code length is not divisible by the
+                                    // instruction length
+            CLOSING_BRACE_EXPECTED,    // There is an open brace that was not
+                                       // closed
+            OPENING_BRACE_EXPECTED     // There is a closed brace without a
+                                       // correspondent
+        };
+
+        /**
+         * @brief Types of RuntimeExceptions the Glypho interpreter can throw
+         *
+         */
+        enum class RuntimeException {
+            EMPTY_STACK,    // The operation needs at least one element on the
+                            // stack, but it is empty
+            INSUFFICIENT_STACK_SIZE,    // The operation needs more elements
+                                        // than are available on the stack
+            INVALID_INPUT_BASE,     // The base of the input numbers is not the
+                                    // one expected
+            DIVISION_BY_0,          // A division by 0 was attempted
+            INPUT_NOT_VALID_INT,    // The value provided was not a integer
+            INVALID_EXECUTE         // We got a brace from an execute
+        };
+
+        /**
+         * @brief What caused a Failure
+         *
+         */
+        enum class Category {
+            Argument,    // The arguments, or the files, are not valid
+            Syntax,      // A SyntaxError, found when the program was loaded
+            Runtime      // A RuntimeException, raised by an instruction
+        };
+
+        /**
+         * @brief An error that stops the program, with the message printed to
+         * stderr and the exit code. The errors are thrown instead of exiting,
+         * so the driver decides what they stop: a single program reports the
+         * error and exits (see Diagnostics::report), while a batch or an
+         * embedding application only stops the run that raised it.
+         */
+        class Failure : public std::exception {
+           private:
+            std::string text;    // The message, with the final new line
+            int code;            // The exit code
+            Category category;
+            int error;               // The SyntaxError / RuntimeException
+            long int instruction;    // The id of the instruction, or -1
+
+           public:
+            /**
+             * @brief Construct a new Failure object, for an argument error
+             *
+             * @param text The message
+             * @param code The exit code
+             */
+            Failure(const std::string& text, const int code)
+                : text(text),
+                  code(code),
+                  category(Category::Argument),
+                  error(0),
+                  instruction(-1) {}
+
+            /**
+             * @brief Construct a new Failure object, for a SyntaxError or a
+             * RuntimeException
+             *
+             * @param text The message
+             * @param code The exit code
+             * @param category The category of the error
+             * @param error The value of the SyntaxError / RuntimeException
+             * @param instruction The id of the instruction
+             */
+            Failure(const std::string& text, const int code,
+                    const Category category, const int error,
+                    const long int instruction)
+                : text(text),
+                  code(code),
+                  category(category),
+                  error(error),
+                  instruction(instruction) {}
+
+            /**
+             * @brief Get the message
+             *
+             * @return const char* The message
+             */
+            const char* what() const noexcept override { return text.c_str(); }
+
+            /**
+             * @brief Get the exit code of the program
+             *
+             * @return int The exit code
+             */
+            int exit_code() const { return code; }
+
+            /**
+             * @brief Get what caused the error
+             *
+             * @return Category The category
+             */
+            Category get_category() const { return category; }
+
+            /**
+             * @brief Get the SyntaxError or RuntimeException (0 for the
+             * argument errors)
+             *
+             * @return int The value of the error
+             */
+            int get_error() const { return error; }
+
+            /**
+             * @brief Get the instruction that caused the error
+             *
+             * @return long int The id of the instruction (-1 if none)
+             */
+            long int get_instruction() const { return instruction; }
+        };
+    }    // namespace Throwable
+
     namespace Helpers {
         /**
-         * @brief Check if the condition is triggered. If it is not, print the
-         * error message and exit the program
+         * @brief Check if the condition is triggered. If it is not, stop the
+         * program with the error message
          * @param condition The condition that must happen
          * @param error The error message
          * @param code The exit code
          */
         inline void MUST(bool condition, std::string error, int code = -1) {
-            if (!condition) {
-                std::cerr << error;
-                exit(code);
-            }
+            if (!condition) { throw Throwable::Failure(error, code); }
         }
 
         /**
-         * @brief Check if the condition is triggered. If it is, print the
-         * error message and exit the program
+         * @brief Check if the condition is triggered. If it is, stop the
+         * program with the error message
          * @param condition The condition that must happen
          * @param error The error message
          * @param code The exit code
          */
         inline void MUST_NOT(bool condition, std::string error, int code = -1) {
-            if (condition) {
-                std::cerr << error;
-                exit(code);
-            }
+            if (condition) { throw Throwable::Failure(error, code); }
         }
 
         /**
@@ -61,55 +186,45 @@ namespace Glypho {
         int numValue(const char number);
 
         /**
-         * @brief Function to convert a number from decimal to a specified base
+         * @brief Function to convert a number to a specified base
          *
          * @param base The target base
          * @param inputNumber The original number
          * @return std::string The converted number (as a string)
          */
-        std::string switchToBase(int base, long long int inputNumber);
+        std::string switchToBase(int base, const Core::Integer& inputNumber);
 
         /**
-         * @brief Function to convert a number from a specified base to decimal
+         * @brief Function to convert a number from a specified base
          *
          * @param base The source base
          * @param str The original number
-         * @return long long int The converted number (as a string)
+         * @param valid Set to false if the string is not a valid number
+         * @return Core::Integer The converted number
          */
-        long long int switchFromBase(int base, std::string str);
+        Core::Integer switchFromBase(int base, std::string str, bool* valid);
 
-    }    // namespace Helpers
-
-    namespace Throwable {
         /**
-         * @brief Types of SyntaxErrors the Glypho interpreter can throw
+         * @brief Read a number from stdin, in the specified base. Stops the
+         * program if the input is not a valid integer
          *
+         * @param base The base of the number
+         * @param id The id of the instruction that reads (for error handling)
+         * @return Core::Integer The number
          */
-        enum class SyntaxError {
-            CODE_LENGTH_INVALID,    // The code length is not divisible by the
-                                    // instruction length
-            CLOSING_BRACE_EXPECTED,    // There is an open brace that was not
-                                       // closed
-            OPENING_BRACE_EXPECTED     // There is a closed brace without a
-                                       // correspondent
-        };
+        Core::Integer readNumber(int base, long int id);
 
         /**
-         * @brief Types of RuntimeExceptions the Glypho interpreter can throw
+         * @brief Print a number to stdout, in the specified base
          *
+         * @param base The base of the number
+         * @param number The number
          */
-        enum class RuntimeException {
-            EMPTY_STACK,    // The operation needs at least one element on the
-                            // stack, but it is empty
-            INSUFFICIENT_STACK_SIZE,    // The operation needs more elements
-                                        // than are available on the stack
-            INVALID_INPUT_BASE,     // The base of the input numbers is not the
-                                    // one expected
-            DIVISION_BY_0,          // A division by 0 was attempted
-            INPUT_NOT_VALID_INT,    // The value provided was not a integer
-            INVALID_EXECUTE         // We got a brace from an execute
-        };
+        void printNumber(int base, const Core::Integer& number);
+
+    }    // namespace Helpers
 
+    namespace Throwable {
         /**
          * @brief Returns the message associated to a specific SyntaxError
          *
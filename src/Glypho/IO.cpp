@@ -0,0 +1,318 @@
+/**
+ * @file IO.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the buffered I/O
+ * @copyright Copyright (c) 2020
+ */
+
+#include "IO.hpp"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Helpers.hpp"
+
+using namespace Glypho;
+
+namespace {
+    const size_t BUFFER_SIZE = 1 << 16;
+}    // namespace
+
+namespace Glypho::IO {
+    /**
+     * @brief Reads the whitespace-separated tokens of a file descriptor (or
+     * of a Source). If it is a regular file, it is mapped, otherwise it is
+     * read in large blocks.
+     */
+    class Reader {
+       private:
+        int fd;
+        Source source;    // Supplies the input, instead of the fd
+        std::vector<char> buffer;
+        const char* data;    // The mapped file, or the buffer
+        size_t size;         // The number of bytes available
+        size_t position;     // The next unread byte
+        size_t mapped_size;
+        bool opened;
+        bool finished;    // If the end of stdin was reached
+
+        void open() {
+            opened = true;
+
+            // Map the rest of the file, starting at the current offset (a
+            // Source has no file descriptor, so it is never mapped)
+            struct stat info;
+            off_t offset = lseek(fd, 0, SEEK_CUR);
+            if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+                offset >= 0 && info.st_size > offset) {
+                void* mapped = mmap(nullptr, info.st_size, PROT_READ,
+                                    MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    mapped_size = info.st_size;
+                    data = (const char*)mapped;
+                    position = offset;
+                    size = mapped_size;
+                    finished = true;
+                    return;
+                }
+            }
+
+            buffer.resize(BUFFER_SIZE);
+            data = buffer.data();
+        }
+
+        /**
+         * @brief Read another block, keeping the bytes starting at keep (they
+         * are moved to the start of the buffer)
+         *
+         * @param keep The first byte that is still needed
+         * @return size_t How much the kept bytes moved
+         */
+        size_t refill(size_t keep) {
+            // The output is written before blocking, like a prompt
+            IO::flush();
+
+            std::memmove(buffer.data(), buffer.data() + keep, size - keep);
+            size -= keep;
+            position -= keep;
+            if (size == buffer.size()) { buffer.resize(buffer.size() * 2); }
+            data = buffer.data();
+
+            ssize_t count;
+            if (source) {
+                count = source(buffer.data() + size, buffer.size() - size);
+            } else {
+                do {
+                    count =
+                        read(fd, buffer.data() + size, buffer.size() - size);
+                } while (count < 0 && errno == EINTR);
+            }
+
+            if (count <= 0) {
+                finished = true;
+            } else {
+                size += count;
+            }
+            return keep;
+        }
+
+        static bool is_space(const char character) {
+            return character == ' ' || (character >= '\t' && character <= '\r');
+        }
+
+       public:
+        Reader(const int fd, const Source& source)
+            : fd(fd),
+              source(source),
+              data(nullptr),
+              size(0),
+              position(0),
+              mapped_size(0),
+              opened(false),
+              finished(false) {}
+
+        ~Reader() {
+            if (mapped_size != 0) { munmap((void*)data, mapped_size); }
+        }
+
+        /**
+         * @brief Get the next token. It stays valid until the next call.
+         *
+         * @param length Where the length is stored (0 if there is no token)
+         * @return const char* The token
+         */
+        const char* next(size_t* length) {
+            if (!opened) { open(); }
+
+            // Skip the whitespace
+            while (true) {
+                while (position < size && is_space(data[position])) {
+                    position++;
+                }
+                if (position < size || finished) { break; }
+                refill(position);
+            }
+
+            size_t start = position;
+            while (true) {
+                while (position < size && !is_space(data[position])) {
+                    position++;
+                }
+                if (position < size || finished) { break; }
+                start -= refill(start);
+            }
+
+            *length = position - start;
+            return data + start;
+        }
+    };
+
+    /**
+     * @brief Collects the output in a large buffer, written in bulk to a
+     * file descriptor (or passed to a Sink). The rest is written when the
+     * program exits (the destructor of the static writer runs even if the
+     * program is stopped by an error).
+     */
+    class Writer {
+       private:
+        int fd;
+        Sink sink;    // Receives the output, instead of the fd
+        std::vector<char> buffer;
+        size_t size;
+
+       public:
+        Writer(const int fd, const Sink& sink)
+            : fd(fd), sink(sink), buffer(BUFFER_SIZE), size(0) {}
+
+        ~Writer() { flush(); }
+
+        void flush() {
+            // The Sink can throw, so the buffer is emptied before it is called
+            if (sink) {
+                size_t pending = size;
+                size = 0;
+                if (pending != 0) { sink(buffer.data(), pending); }
+                return;
+            }
+
+            size_t written = 0;
+
+            while (written < size) {
+                ssize_t count =
+                    write(fd, buffer.data() + written, size - written);
+                if (count < 0 && errno == EINTR) { continue; }
+                if (count <= 0) { break; }
+                written += count;
+            }
+            size = 0;
+        }
+
+        /**
+         * @brief Get space for more bytes (it must be at most BUFFER_SIZE)
+         *
+         * @param length The number of bytes
+         * @return char* Where they are written
+         */
+        char* reserve(const size_t length) {
+            if (size + length > buffer.size()) { flush(); }
+            return buffer.data() + size;
+        }
+
+        void commit(const size_t length) { size += length; }
+
+        void append(const char* text, size_t length) {
+            while (length > 0) {
+                size_t part = std::min(length, BUFFER_SIZE);
+                std::memcpy(reserve(part), text, part);
+                commit(part);
+                text += part;
+                length -= part;
+            }
+        }
+    };
+
+}    // namespace Glypho::IO
+
+namespace {
+    IO::Reader standard_reader(STDIN_FILENO, nullptr);
+    IO::Writer standard_writer(STDOUT_FILENO, nullptr);
+
+    // The I/O of the current thread
+    thread_local IO::Reader* reader = &standard_reader;
+    thread_local IO::Writer* writer = &standard_writer;
+
+    /**
+     * @brief Write the digits of a number, ending at the specified position
+     *
+     * @param magnitude The number
+     * @param end Where the last digit ends
+     * @return char* Where the first digit starts
+     */
+    template <unsigned int Base>
+    char* format(uint64_t magnitude, char* end) {
+        do {
+            *--end = Helpers::charValue(magnitude % Base);
+            magnitude /= Base;
+        } while (magnitude != 0);
+
+        return end;
+    }
+
+    char* format(uint64_t magnitude, const unsigned int base, char* end) {
+        do {
+            *--end = Helpers::charValue(magnitude % base);
+            magnitude /= base;
+        } while (magnitude != 0);
+
+        return end;
+    }
+}    // namespace
+
+Core::Integer IO::read_number(const int base, bool* valid) {
+    size_t length;
+    const char* token = reader->next(&length);
+
+    return Core::Integer::parse(token, length, base, valid);
+}
+
+void IO::write_number(const int base, const Core::Integer& number) {
+    int64_t value;
+
+    // The big numbers are converted separately
+    if (!number.get_small(&value)) {
+        std::string digits = number.to_string(base);
+        digits += '\n';
+        writer->append(digits.data(), digits.size());
+        return;
+    }
+
+    // Enough for 64 binary digits, the sign and the new line
+    char digits[72];
+    char* end = digits + sizeof(digits);
+    *--end = '\n';
+
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : value;
+    char* start = (base == 10) ? format<10>(magnitude, end)
+                               : format(magnitude, base, end);
+    if (value < 0) { *--start = '-'; }
+
+    size_t length = digits + sizeof(digits) - start;
+    std::memcpy(writer->reserve(length), start, length);
+    writer->commit(length);
+}
+
+void IO::flush() { writer->flush(); }
+
+IO::Redirect::Redirect(const int input, std::string* output)
+    : Redirect(input, nullptr, [output](const char* data, size_t size) {
+          output->append(data, size);
+      }) {}
+
+IO::Redirect::Redirect(const Source& input, const Sink& output)
+    : Redirect(-1, input, output) {}
+
+IO::Redirect::Redirect(const int fd, const Source& input, const Sink& output)
+    : reader(std::make_unique<Reader>(fd, input)),
+      writer(std::make_unique<Writer>(-1, output)),
+      previous_reader(::reader),
+      previous_writer(::writer) {
+    ::reader = reader.get();
+    ::writer = writer.get();
+}
+
+IO::Redirect::~Redirect() {
+    // An error of the Sink can not be reported from here; to see it, flush()
+    // is called before the Redirect is destroyed
+    try {
+        writer->flush();
+    } catch (...) {
+    }
+    ::reader = previous_reader;
+    ::writer = previous_writer;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file IO.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief The buffered I/O used by the Input and Output instructions. The
+ * numbers are parsed directly from a large read buffer over stdin (or from
+ * the mapped file, if stdin is a regular file), and are formatted into a
+ * large write buffer, that is flushed in bulk. The I/O of a thread can be
+ * redirected, so multiple programs can run in the same process.
+ * @copyright Copyright (c) 2020
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "Integer.hpp"
+
+namespace Glypho::IO {
+    class Reader;
+    class Writer;
+
+    /**
+     * @brief Supplies the input of a program: it fills the buffer with at
+     * most size bytes, and returns how many it wrote (0 at the end)
+     */
+    using Source = std::function<size_t(char* buffer, size_t size)>;
+
+    /**
+     * @brief Receives the output of a program, in large blocks. It can throw
+     * (a Throwable::Failure), to stop the program if the output can not be
+     * delivered.
+     */
+    using Sink = std::function<void(const char* data, size_t size)>;
+
+    /**
+     * @brief Read the next number (a whitespace-separated token) from stdin.
+     * The token is validated and converted in place, without copying it.
+     *
+     * @param base The base of the number
+     * @param valid Set to false if the token is missing or is not a number
+     * @return Core::Integer The number (0 if it is not valid)
+     */
+    Core::Integer read_number(const int base, bool* valid);
+
+    /**
+     * @brief Write a number (followed by a new line) to stdout
+     *
+     * @param base The base of the number
+     * @param number The number
+     */
+    void write_number(const int base, const Core::Integer& number);
+
+    /**
+     * @brief Write the buffered output. This is done automatically when the
+     * buffer is full, before blocking on stdin, and when the program exits.
+     */
+    void flush();
+
+    /**
+     * @brief Redirects the I/O of the calling thread, while it exists: the
+     * numbers are read from a file descriptor (that stays open) or a Source,
+     * and the output is collected in a string or passed to a Sink (it is
+     * complete after the Redirect is destroyed).
+     */
+    class Redirect {
+       private:
+        std::unique_ptr<Reader> reader;
+        std::unique_ptr<Writer> writer;
+        Reader* previous_reader;
+        Writer* previous_writer;
+
+        /**
+         * @brief Construct a new Redirect object
+         *
+         * @param fd The file descriptor the input is read from (if there is
+         * no Source)
+         * @param input Supplies the input
+         * @param output Receives the output
+         */
+        Redirect(const int fd, const Source& input, const Sink& output);
+
+       public:
+        /**
+         * @brief Construct a new Redirect object
+         *
+         * @param input The file descriptor the input is read from
+         * @param output Where the output is collected
+         */
+        Redirect(const int input, std::string* output);
+
+        /**
+         * @brief Construct a new Redirect object, for the I/O of the caller
+         *
+         * @param input Supplies the input
+         * @param output Receives the output
+         */
+        Redirect(const Source& input, const Sink& output);
+
+        Redirect(const Redirect& other) = delete;
+        Redirect& operator=(const Redirect& other) = delete;
+
+        /**
+         * @brief Destroy the Redirect object, flushing the output into the
+         * string and restoring the previous I/O of the thread
+         */
+        ~Redirect();
+    };
+}    // namespace Glypho::IO
@@ -7,45 +7,205 @@
 
 #include "InputParser.hpp"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "Diagnostics.hpp"
+#include "ThreadPool.hpp"
+
 using namespace Glypho::Core;
 
-std::vector<std::string> InputParser::read_data(std::istream& input) {
-    std::vector<std::string> encoded_instructions;
+namespace {
+    /**
+     * @brief Check if a character is part of the code
+     *
+     * @param character The character
+     * @return bool If it is valid (33 - 126)
+     */
+    inline bool is_valid(const char character) {
+        return (unsigned char)(character - 33) < 94;
+    }
+
+    /**
+     * @brief Count the valid characters of a part of the file
+     *
+     * @param data The start of the part
+     * @param size The size of the part
+     * @return size_t The number of valid characters
+     */
+    size_t count_valid(const char* data, const size_t size) {
+        size_t count = 0;
+        for (size_t i = 0; i < size; ++i) { count += is_valid(data[i]); }
+        return count;
+    }
 
-    std::string instruction = "";
-    char character;
+    /**
+     * @brief Decode the instructions that start in a chunk of the file. The
+     * last one can end in the next chunks.
+     *
+     * @param data The start of the chunk
+     * @param size The size of the chunk
+     * @param available The size of the file, starting with the chunk
+     * @param skip The valid characters of the previous instruction
+     * @param instructions Where the instructions are stored
+     */
+    void decode_chunk(const char* data, const size_t size,
+                      const size_t available, const size_t skip,
+                      InstructionType* instructions) {
+        const size_t BATCH = 1 << 12;
+        char valid[BATCH];
+        size_t filled = 0, skipped = 0, position = 0;
 
-    while (input >> character) {
-        // Ignore invalid characters
-        if (character < 33 || character > 126) continue;
+        while (position < size || filled % 4 != 0) {
+            if (position == available) { break; }
 
-        instruction.push_back(character);
+            char character = data[position++];
+            if (!is_valid(character)) { continue; }
+            if (skipped < skip) {
+                skipped++;
+                continue;
+            }
 
-        // If we read 4 character, we have an instruction
-        if (instruction.length() == 4) {
-            encoded_instructions.push_back(instruction);
-            instruction = "";
+            valid[filled++] = character;
+            if (filled == BATCH) {
+                decode_groups(valid, BATCH / 4, instructions);
+                instructions += BATCH / 4;
+                filled = 0;
+            }
         }
+
+        decode_groups(valid, filled / 4, instructions);
+    }
+}    // namespace
+
+std::vector<InstructionType> InputParser::read_data(const int descriptor) {
+    std::vector<InstructionType> instructions;
+    std::vector<char> chunk(CHUNK_SIZE);
+
+    // The valid characters (33 - 126) of the chunk, after the ones left
+    // from the previous chunk (an incomplete instruction)
+    std::vector<char> valid(CHUNK_SIZE + 4);
+    size_t filled = 0;
+
+    while (true) {
+        ssize_t count = read(descriptor, chunk.data(), chunk.size());
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+
+        // Every character is stored, but only the valid ones are kept
+        for (ssize_t i = 0; i < count; ++i) {
+            unsigned char character = chunk[i];
+            valid[filled] = character;
+            filled += (unsigned char)(character - 33) < 94;
+        }
+
+        // Decode the complete instructions, in bulk
+        size_t groups = filled / 4;
+        instructions.resize(instructions.size() + groups);
+        decode_groups(valid.data(), groups,
+                      instructions.data() + instructions.size() - groups);
+
+        std::copy(valid.begin() + groups * 4, valid.begin() + filled,
+                  valid.begin());
+        filled %= 4;
     }
 
     // If we have finished to read the code, but we haven't finished to read
     // an instruction, we must throw the SyntaxError
-    Helpers::MUST(
-        instruction.length() == 0,
-        Throwable::message(Throwable::SyntaxError::CODE_LENGTH_INVALID,
-                           encoded_instructions.size()) +
-            "\n");
+    Diagnostics::MUST(filled == 0, Throwable::SyntaxError::CODE_LENGTH_INVALID,
+                      instructions.size());
 
-    return encoded_instructions;
+    return instructions;
 }
 
-std::vector<std::string> InputParser::read_data(std::string path) {
-    std::ifstream input(path);
+std::vector<InstructionType> InputParser::read_mapped(const char* data,
+                                                      const size_t size) {
+    ThreadPool& pool = ThreadPool::instance();
+    size_t thread_count = pool.size();
+    std::vector<size_t> starts(thread_count + 1);
+    std::vector<size_t> counts(thread_count);
+
+    for (size_t i = 0; i <= thread_count; ++i) {
+        starts[i] = size / thread_count * i + std::min(i, size % thread_count);
+    }
+
+    // Count the valid characters of each chunk
+    pool.run(thread_count, [data, &starts, &counts](size_t i) {
+        counts[i] = count_valid(data + starts[i], starts[i + 1] - starts[i]);
+    });
+
+    // The number of valid characters before each chunk
+    std::vector<size_t> offsets(thread_count + 1, 0);
+    for (size_t i = 0; i < thread_count; ++i) {
+        offsets[i + 1] = offsets[i] + counts[i];
+    }
+
+    // The SyntaxError is the same as when the file is read serially
+    size_t total = offsets[thread_count];
+    Diagnostics::MUST(total % 4 == 0,
+                      Throwable::SyntaxError::CODE_LENGTH_INVALID, total / 4);
+
+    std::vector<InstructionType> instructions(total / 4);
+    pool.run(thread_count, [&](size_t i) {
+        // The first characters of a chunk can end an instruction that
+        // starts in the previous one
+        size_t skip = (4 - offsets[i] % 4) % 4;
+        size_t first = (offsets[i] + skip) / 4;
+
+        decode_chunk(data + starts[i], starts[i + 1] - starts[i],
+                     size - starts[i], skip, instructions.data() + first);
+    });
+
+    return instructions;
+}
+
+std::vector<InstructionType> InputParser::read_data(std::string path) {
+    int descriptor = open(path.c_str(), O_RDONLY);
 
     // Exit the program if the input file is unavailable
     Helpers::MUST_NOT(
-        input.fail() || input.bad(),
+        descriptor < 0,
         "ArgumentError: Couldn't find or open the specified file\n");
 
-    return InputParser::read_data(input);
+    // Large files are mapped and read in parallel
+    struct stat info;
+    if (fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) &&
+        (size_t)info.st_size >= PARALLEL_THRESHOLD) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                            descriptor, 0);
+
+        if (mapped != MAP_FAILED) {
+            close(descriptor);
+            std::vector<InstructionType> instructions =
+                read_mapped((const char*)mapped, info.st_size);
+            munmap(mapped, info.st_size);
+
+            return instructions;
+        }
+    }
+
+    std::vector<InstructionType> instructions = read_data(descriptor);
+    close(descriptor);
+
+    return instructions;
+}
+
+std::vector<InstructionType> InputParser::read_memory(const char* data,
+                                                      const size_t size) {
+    if (size >= PARALLEL_THRESHOLD) { return read_mapped(data, size); }
+
+    // A single chunk, decoded by the calling thread
+    size_t total = count_valid(data, size);
+    Diagnostics::MUST(total % 4 == 0,
+                      Throwable::SyntaxError::CODE_LENGTH_INVALID, total / 4);
+
+    std::vector<InstructionType> instructions(total / 4);
+    decode_chunk(data, size, size, 0, instructions.data());
+
+    return instructions;
 }
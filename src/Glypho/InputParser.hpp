@@ -1,42 +1,76 @@
 /**
  * @file InputParser.hpp
  * @author Grama Nicolae (gramanicu@gmail.com)
- * @brief Declares the InputParser, used by the interpreter to get the (encoded)
- * instructions from the code file (or a stream).
+ * @brief Declares the InputParser, used by the interpreter to get the
+ * instructions from the code file
  * @copyright Copyright (c) 2020
  */
 #pragma once
 
-#include <fstream>
+#include <string>
 #include <vector>
 
 #include "Helpers.hpp"
+#include "Instruction.hpp"
 
 namespace Glypho::Core {
+    /**
+     * @brief Declaration for the InputParser class
+     * The file is streamed in fixed-size chunks, and the complete groups of
+     * 4 valid characters of each chunk are decoded in bulk, so only the
+     * decoded instructions are kept in memory.
+     * Large files are mapped and split into a chunk for each thread of the
+     * ThreadPool: the valid characters of every chunk are counted in
+     * parallel, a prefix sum gives the index of the first instruction that
+     * starts in each chunk, and then the chunks are decoded in parallel,
+     * straight into the result.
+     */
     class InputParser {
        private:
+        static const size_t CHUNK_SIZE = 1 << 16;
+        static const size_t PARALLEL_THRESHOLD = 1 << 22;
+
         /**
          * @brief Private constructor to disallow instantiation of this class
          */
         InputParser(){};
 
         /**
-         * @brief Read Glypho code from an input stream
+         * @brief Read Glypho code from a file descriptor, until its end
+         *
+         * @param descriptor The file descriptor
+         * @return std::vector<InstructionType> The decoded instructions
+         */
+        static std::vector<InstructionType> read_data(const int descriptor);
+
+        /**
+         * @brief Read Glypho code from a mapped file, using all the threads
          *
-         * @param input The stream
-         * @return std::vector<std::string> An array of encoded instructions
-         * (chars grouped 4 by 4)
+         * @param data The contents of the file
+         * @param size The size of the file
+         * @return std::vector<InstructionType> The decoded instructions
          */
-        static std::vector<std::string> read_data(std::istream& input);
+        static std::vector<InstructionType> read_mapped(const char* data,
+                                                        const size_t size);
 
        public:
         /**
          * @brief Read Glypho code from a file
          *
-         * @param filename The path to the source code file
-         * @return std::vector<std::string> An array of encoded instructions
-         * (chars grouped 4 by 4)
+         * @param path The path to the source code file
+         * @return std::vector<InstructionType> The decoded instructions
+         */
+        static std::vector<InstructionType> read_data(std::string path);
+
+        /**
+         * @brief Read Glypho code from memory (large buffers are read using
+         * all the threads, like the mapped files)
+         *
+         * @param data The source code
+         * @param size The size of the source code
+         * @return std::vector<InstructionType> The decoded instructions
          */
-        static std::vector<std::string> read_data(std::string path);
+        static std::vector<InstructionType> read_memory(const char* data,
+                                                        const size_t size);
     };
-}    // namespace Glypho::Core
\ No newline at end of file
+}    // namespace Glypho::Core
@@ -7,6 +7,12 @@
 
 #include "Instruction.hpp"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Diagnostics.hpp"
+
 using namespace Glypho::Core;
 
 std::string Glypho::Core::instruction_name(InstructionType type) {
@@ -30,239 +36,199 @@ std::string Glypho::Core::instruction_name(InstructionType type) {
     return "";
 }
 
-std::string Glypho::Core::encode_number_array(std::vector<long long int>& arr) {
-    std::vector<char> encodes;
-    std::string res = "";
+namespace {
+    /**
+     * @brief Computes the index in the decoding table, a bit for each pair
+     * of equal values. The first 3 bits compare the neighbours, the next 2
+     * the values 2 apart and the last one the ends, like the SIMD decoder.
+     *
+     * @param values The 4 values
+     * @return int The index (0 - 63)
+     */
+    template <typename T>
+    inline int equality_mask(const T values[4]) {
+        return (values[0] == values[1]) | (values[1] == values[2]) << 1 |
+               (values[2] == values[3]) << 2 | (values[0] == values[2]) << 3 |
+               (values[1] == values[3]) << 4 | (values[0] == values[3]) << 5;
+    }
 
-    // Associated a number to each instruction integer
-    char current_code = '0';
-    for (int i = 0; i < 4; ++i) {
-        int code = current_code++;
+    /**
+     * @brief The instruction encoded by a canonical pattern (the digit of
+     * each value, in the order of their first occurrence)
+     */
+    struct Pattern {
+        InstructionType type;
+    };
+
+    /**
+     * @brief Get the instruction encoded by a canonical pattern
+     *
+     * @param code The pattern, as a base 3 number
+     * @return InstructionType The instruction
+     */
+    constexpr InstructionType type_of(const int code) {
+        switch (code) {
+            case 1: return InstructionType::Input;
+            case 3: return InstructionType::Rot;
+            case 4: return InstructionType::Swap;
+            case 5: return InstructionType::Push;
+            case 9: return InstructionType::RRot;
+            case 10: return InstructionType::Dup;
+            case 11: return InstructionType::Add;
+            case 12: return InstructionType::LBrace;
+            case 13: return InstructionType::Output;
+            case 14: return InstructionType::Multiply;
+            case 15: return InstructionType::Execute;
+            case 16: return InstructionType::Negate;
+            case 17: return InstructionType::Pop;
+            case 18: return InstructionType::RBrace;
+            default: return InstructionType::NOP;
+        }
+    }
 
-        for (int j = 0; j < i; ++j) {
-            if (arr[i] == arr[j]) {
-                code = encodes[j];
-                break;
+    struct PatternTable {
+        Pattern patterns[64];
+    };
+
+    /**
+     * @brief Builds the decoding table, at compile time. Only 15 of the
+     * masks are possible (the equalities are transitive), the others are
+     * never looked up.
+     *
+     * @return PatternTable The pattern of each equality mask
+     */
+    constexpr PatternTable build_pattern_table() {
+        // The bit of each pair, as in equality_mask
+        const int bits[4][4] = {
+            {0, 0, 3, 5}, {0, 0, 1, 4}, {3, 1, 0, 2}, {5, 4, 2, 0}};
+        PatternTable table{};
+
+        for (int mask = 0; mask < 64; ++mask) {
+            int digits[4] = {0, -1, -1, -1};
+            int next = 1, code = 0;
+
+            // A value gets the digit of the first equal value, or a new one
+            for (int i = 1; i < 4; ++i) {
+                for (int j = 0; j < i && digits[i] < 0; ++j) {
+                    if (mask >> bits[j][i] & 1) { digits[i] = digits[j]; }
+                }
+                if (digits[i] < 0) { digits[i] = next++; }
             }
+
+            for (int i = 0; i < 4; ++i) {
+                code = code * 3 + digits[i];
+            }
+            table.patterns[mask].type = type_of(code);
         }
 
-        encodes.push_back(code);
+        return table;
     }
 
-    for (auto& c : encodes) { res += c; }
+    constexpr PatternTable PATTERNS = build_pattern_table();
+}    // namespace
 
-    return res;
+InstructionType Glypho::Core::decode_group(const char group[4]) {
+    return PATTERNS.patterns[equality_mask(group)].type;
 }
 
-Instruction::Instruction()
-    : type(InstructionType::NOP),
-      instruction_id(-1),
-      next_instruction_id(-1),
-      jump_id(-1),
-      parent_exec(-1) {}
-
-Instruction::Instruction(const std::string& encoded_instruction,
-                         const long int id)
-    : type(InstructionType::NOP),
-      instruction_id(id),
-      next_instruction_id(-1),
-      jump_id(-1),
-      parent_exec(id) {
-    std::unordered_map<char, int> associated_code;
-    std::unordered_map<char, bool> appeared;
-
-    // Associated a number to each instruction character
-    int current_code = 0;
-    for (char c : encoded_instruction) {
-        if (!appeared[c]) {
-            associated_code[c] = current_code++;
-            appeared[c] = true;
+void Glypho::Core::decode_groups(const char* groups, const size_t count,
+                                 InstructionType* types) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Each 32-bit lane is a group. Shifting the lanes by 1, 2 and 3 bytes
+    // aligns every pair of characters, so 3 byte compares give the 6
+    // equalities of 4 groups.
+    for (; i + 4 <= count; i += 4) {
+        __m128i group = _mm_loadu_si128((const __m128i*)(groups + 4 * i));
+        int near = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(group, _mm_srli_epi32(group, 8)));
+        int middle = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(group, _mm_srli_epi32(group, 16)));
+        int ends = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(group, _mm_srli_epi32(group, 24)));
+
+        for (int lane = 0; lane < 4; ++lane) {
+            int mask = (near >> 4 * lane & 7) |
+                       (middle >> 4 * lane & 3) << 3 |
+                       (ends >> 4 * lane & 1) << 5;
+            types[i + lane] = PATTERNS.patterns[mask].type;
         }
     }
+#endif
 
-    // Decode the instruction
-    int decoded_instruction = 0;
-    int power = 3;
-    for (char c : encoded_instruction) {
-        decoded_instruction += pow(3, power--) * associated_code[c];
-    }
-
-    // Set the instruction type
-    switch (decoded_instruction) {
-        case 0: type = InstructionType::NOP; break;
-        case 1: type = InstructionType::Input; break;
-        case 3: type = InstructionType::Rot; break;
-        case 4: type = InstructionType::Swap; break;
-        case 5: type = InstructionType::Push; break;
-        case 9: type = InstructionType::RRot; break;
-        case 10: type = InstructionType::Dup; break;
-        case 11: type = InstructionType::Add; break;
-        case 12: type = InstructionType::LBrace; break;
-        case 13: type = InstructionType::Output; break;
-        case 14: type = InstructionType::Multiply; break;
-        case 15: type = InstructionType::Execute; break;
-        case 16: type = InstructionType::Negate; break;
-        case 17: type = InstructionType::Pop; break;
-        case 18: type = InstructionType::RBrace; break;
-    }
-}
-
-Instruction::Instruction(const Instruction& other) {
-    this->type = other.type;
-    this->instruction_id = other.instruction_id;
-    this->next_instruction_id = other.next_instruction_id;
-    this->jump_id = other.jump_id;
-    this->parent_exec = other.parent_exec;
-}
-
-Instruction& Instruction::operator=(const Instruction& other) {
-    this->type = other.type;
-    this->instruction_id = other.instruction_id;
-    this->next_instruction_id = other.next_instruction_id;
-    this->jump_id = other.jump_id;
-    this->parent_exec = other.parent_exec;
-    return *this;
+    for (; i < count; ++i) { types[i] = decode_group(groups + 4 * i); }
 }
 
-long int Instruction::get_id() const { return instruction_id; }
-
-long int Instruction::get_next_id() const { return next_instruction_id; }
-
-void Instruction::set_next_id(const long int next_id) {
-    next_instruction_id = next_id;
+InstructionType Glypho::Core::decode_number_array(const Integer values[4]) {
+    return PATTERNS.patterns[equality_mask(values)].type;
 }
 
-void Instruction::set_jump_id(const long int next_id) { jump_id = next_id; }
-
-long int Instruction::get_jump_id() const { return jump_id; }
-
-InstructionType Instruction::get_type() const { return type; }
-
-void Instruction::set_parent_exec(const long int parent_exec_id) {
-    parent_exec = parent_exec_id;
-}
-
-long int Instruction::get_parent_exec_id() const { return parent_exec; }
-
-void Instruction::execute(Stack* glypho_stack, long int* program_instruction_id,
-                          std::vector<Core::Instruction>* program,
-                          const int base) const {
-    bool is_jumping = false;
-    int next_instr_id = this->get_next_id();
-
+void Glypho::Core::execute_operation(InstructionType type, Stack* glypho_stack,
+                                     const long int id, const int base) {
     switch (type) {
         case InstructionType::Input: {
             // Read a number from stdin and add it to the stack
-            std::string number;
-            std::cin >> number;
-
-            // Parse the input (change from original base to base 10)
-            try {
-                stoll(number, nullptr, base);
-            } catch (const std::invalid_argument&) {
-                Helpers::MUST(
-                    false,
-                    Throwable::message(
-                        Throwable::RuntimeException::INPUT_NOT_VALID_INT,
-                        this->get_id()) +
-                        "\n",
-                    -2);
-            } catch (const std::out_of_range&) {
-                // Helpers::MUST(false, "OUT OF RANGE", -2);
-            }
-
-            glypho_stack->Input(Helpers::switchFromBase(base, number));
+            glypho_stack->Input(Helpers::readNumber(base, id));
         } break;
         case InstructionType::Rot: {
-            glypho_stack->Rotate(get_id());
+            glypho_stack->Rotate(id);
         } break;
         case InstructionType::Swap: {
-            glypho_stack->Swap(get_id());
+            glypho_stack->Swap(id);
         } break;
         case InstructionType::Push: {
             glypho_stack->Push();
         } break;
         case InstructionType::RRot: {
-            glypho_stack->ReverseRotate(get_id());
+            glypho_stack->ReverseRotate(id);
         } break;
         case InstructionType::Dup: {
-            glypho_stack->Dup(get_id());
+            glypho_stack->Dup(id);
         } break;
         case InstructionType::Add: {
-            glypho_stack->Add(get_id());
-        } break;
-        case InstructionType::LBrace: {
-            // Jump to associated RBrace if the top element is 0
-            if (glypho_stack->Peek(get_id()) == 0) { is_jumping = true; }
+            glypho_stack->Add(id);
         } break;
         case InstructionType::Output: {
-            std::cout << Helpers::switchToBase(base,
-                                               glypho_stack->Output(get_id()))
-                      << "\n";
+            Helpers::printNumber(base, glypho_stack->Output(id));
         } break;
         case InstructionType::Multiply: {
-            glypho_stack->Multiply(get_id());
-        } break;
-        case InstructionType::Execute: {
-            // Get the instruction from the stack
-            std::vector<long long int> instr_code_arr =
-                glypho_stack->Out_K_Elems(4, get_parent_exec_id());
-            std::string instr_code = encode_number_array(instr_code_arr);
-            long int new_code = program->size();
-
-            // Add the new instruction to the program
-            Instruction new_instruction(instr_code, new_code);
-            new_instruction.set_parent_exec(get_parent_exec_id());
-
-            // Check if we can get this instruction from an execute
-            Helpers::MUST_NOT(
-                (new_instruction.get_type() == InstructionType::RBrace ||
-                 new_instruction.get_type() == InstructionType::LBrace),
-                Throwable::message(Throwable::RuntimeException::INVALID_EXECUTE,
-                                   get_id()) +
-                    "\n",
-                -2);
-
-            // Link the new instruction to the others
-            long int next_id;
-            if (next_instruction_id != -1) {
-                next_id = program->at(next_instruction_id).get_id();
-            } else {
-                next_id = -1;
-            }
-
-            next_instr_id = new_code;
-            new_instruction.set_next_id(next_id);
-            new_instruction.set_jump_id(next_id);
-
-            program->push_back(new_instruction);
+            glypho_stack->Multiply(id);
         } break;
         case InstructionType::Negate: {
-            glypho_stack->Negate(get_id());
+            glypho_stack->Negate(id);
         } break;
         case InstructionType::Pop: {
-            glypho_stack->Pop(get_id());
+            glypho_stack->Pop(id);
         } break;
-        case InstructionType::RBrace: {
-            // Jump to associated LBrace if the top element is 0
-            // If the code jumped to this brace, the stack should not have
-            // changed, so don't have to jump back to the opened brace
-            if (glypho_stack->Peek(get_jump_id()) != 0) { is_jumping = true; }
-        } break;
-        default: { /* NOP */
+        default: { /* NOP, braces and executes are not handled here */
         } break;
     }
+}
 
-    if (is_jumping) {
-        *program_instruction_id = jump_id;
-    } else {
-        *program_instruction_id = next_instr_id;
+InstructionType Glypho::Core::decode_generated(Stack* glypho_stack,
+                                               const long int id) {
+    // Get the instruction from the stack. Executes can generate other
+    // executes, so keep decoding until we get an operation.
+    InstructionType generated = InstructionType::Execute;
+
+    while (generated == InstructionType::Execute) {
+        Integer instr_code_arr[4];
+        glypho_stack->Out_K_Elems(4, instr_code_arr, id);
+        generated = decode_number_array(instr_code_arr);
+
+        // Check if we can get this instruction from an execute
+        Diagnostics::MUST_NOT((generated == InstructionType::RBrace ||
+                               generated == InstructionType::LBrace),
+                              Throwable::RuntimeException::INVALID_EXECUTE, id);
     }
+
+    return generated;
 }
 
-namespace Glypho::Core {
-    std::ostream& operator<<(std::ostream& os, const Instruction& i) {
-        os << instruction_name(i.type);
-        return os;
-    }
-}    // namespace Glypho::Core
\ No newline at end of file
+void Glypho::Core::execute_generated(Stack* glypho_stack, const long int id,
+                                     const int base) {
+    // Run the generated instruction in place
+    execute_operation(decode_generated(glypho_stack, id), glypho_stack, id,
+                      base);
+}
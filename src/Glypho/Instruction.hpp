@@ -6,17 +6,13 @@
  */
 #pragma once
 
-#include <math.h>
-
-#include <ostream>
 #include <string>
-#include <unordered_map>
 
 #include "Helpers.hpp"
 #include "Stack.hpp"
 
 namespace Glypho::Core {
-    enum class InstructionType {
+    enum class InstructionType : uint8_t {
         NOP,
         Input,
         Rot,
@@ -43,125 +39,65 @@ namespace Glypho::Core {
     std::string instruction_name(InstructionType type);
 
     /**
-     * @brief Converts the number array to a string, by assigning a char to each
-     * unique element in the array This is used for the instructions extracted
-     * from the glypho stack
-     * @param arr The array of numbers
-     * @return std::string The encoded instuction
+     * @brief Decodes a group of 4 characters from the source code. Like for
+     * the executes, only the equalities between the characters matter, so
+     * the group is looked up in the same table.
+     * @param group The 4 characters
+     * @return InstructionType The decoded instruction
      */
-    std::string encode_number_array(std::vector<long long int>& arr);
-
-    class Instruction {
-       private:
-        InstructionType type;
-        long int instruction_id;
-        long int next_instruction_id;
-        long int jump_id;    // Used by braces to jump
-        long int
-            parent_exec;    // Used by nested executes, to know the parent id
-
-       public:
-        /**
-         * @brief Construct a new Instruction object
-         * Empty constructor
-         */
-        Instruction();
-
-        /**
-         * @brief Construct a new Instruction object
-         *
-         * @param encoded_instruction The 4-char instruction code
-         * @param id The id of the instruction
-         */
-        Instruction(const std::string& encoded_instruction, const long int id);
-
-        /**
-         * @brief Copy-Constructs a new Instruction object
-         *
-         * @param other
-         */
-        Instruction(const Instruction& other);
-
-        /**
-         * @brief Assignment operator
-         *
-         * @param other The other object
-         * @return Instruction& The new object
-         */
-        Instruction& operator=(const Instruction& other);
-
-        /**
-         * @brief Operator overload for output streams
-         *
-         */
-        friend std::ostream& operator<<(std::ostream& os, const Instruction& i);
+    InstructionType decode_group(const char group[4]);
 
-        /**
-         * @brief Get the id of the instruction
-         *
-         * @return long int The id
-         */
-        long int get_id() const;
-
-        /**
-         * @brief Get the id of the next instruction
-         *
-         * @return long int The id
-         */
-        long int get_next_id() const;
-
-        /**
-         * @brief Get the id of the next instruction (if takes a jump)
-         *
-         * @return long int The id
-         */
-        long int get_jump_id() const;
-
-        /**
-         * @brief Set the id of the next instruction
-         *
-         * @param next_id The id
-         */
-        void set_next_id(const long int next_id);
-
-        /**
-         * @brief Set the id of the next instruction (if takes a jump)
-         *
-         * @param next_id The id
-         */
-        void set_jump_id(const long int next_id);
+    /**
+     * @brief Decodes many consecutive groups of 4 characters. The pairwise
+     * comparisons are done with SIMD instructions, 4 groups at a time.
+     * @param groups The characters (4 for each group)
+     * @param count The number of groups
+     * @param types Where the decoded instructions are stored
+     */
+    void decode_groups(const char* groups, const size_t count,
+                       InstructionType* types);
 
-        /**
-         * @brief Set the parent exec instruction id
-         *
-         * @param parent_exec_id The id of the parent
-         */
-        void set_parent_exec(const long int parent_exec_id);
+    /**
+     * @brief Decodes the 4 numbers extracted by an execute directly into an
+     * instruction type. Only the equalities between the numbers matter, so
+     * the type is looked up in a table indexed by the 6 pairwise comparisons.
+     * @param values The 4 numbers, in extraction order
+     * @return InstructionType The decoded instruction
+     */
+    InstructionType decode_number_array(const Integer values[4]);
 
-        /**
-         * @brief Get the type of the instruction
-         *
-         * @return InstructionType The type
-         */
-        InstructionType get_type() const;
+    /**
+     * @brief Executes an instruction that only changes the stack (or does
+     * I/O), meaning anything but braces and executes
+     *
+     * @param type The type of the instruction
+     * @param glypho_stack The glypho stack the program uses
+     * @param id The id used for error handling
+     * @param base The base of the numbers that can be read from stdin
+     */
+    void execute_operation(InstructionType type, Stack* glypho_stack,
+                           const long int id, const int base);
 
-        /**
-         * @brief Get the parent exec instruction id
-         *
-         * @return long int The id
-         */
-        long int get_parent_exec_id() const;
+    /**
+     * @brief Decodes the instruction generated by an execute, taking its
+     * numbers from the stack. Executes can generate other executes, so the
+     * decoding repeats until an operation is found.
+     *
+     * @param glypho_stack The glypho stack the program uses
+     * @param id The id of the execute, used for all the errors
+     * @return InstructionType The operation (never a brace or an execute)
+     */
+    InstructionType decode_generated(Stack* glypho_stack, const long int id);
 
-        /**
-         * @brief Executes the instructions
-         *
-         * @param glypho_stack The glypho stack the program uses
-         * @param instruction_id The current instruction id in the program
-         * @param program The program (instruction vector)
-         * @param base The base of the numbers that can be read from stdin
-         */
-        void execute(Stack* glypho_stack, long int* instruction_id,
-                     std::vector<Core::Instruction>* program,
-                     const int base) const;
-    };
+    /**
+     * @brief Runs an execute: the instruction is decoded from the stack and
+     * run in place. Executes can generate other executes, so the decoding
+     * repeats until an operation is found.
+     *
+     * @param glypho_stack The glypho stack the program uses
+     * @param id The id of the execute, used for all the errors
+     * @param base The base of the numbers that can be read from stdin
+     */
+    void execute_generated(Stack* glypho_stack, const long int id,
+                           const int base);
 }    // namespace Glypho::Core
\ No newline at end of file
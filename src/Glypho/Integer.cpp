@@ -0,0 +1,486 @@
+/**
+ * @file Integer.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Integer, and the arithmetic on big numbers
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Integer.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Helpers.hpp"
+
+using namespace Glypho::Core;
+
+namespace {
+    typedef std::vector<uint64_t> Limbs;    // The least significant first
+    __extension__ typedef unsigned __int128 uint128_t;
+
+    // Below this size (in limbs), the schoolbook multiplication is faster
+    const size_t KARATSUBA_THRESHOLD = 32;
+
+    /**
+     * @brief A big number. The magnitude never fits in a small Integer, and
+     * has no leading zero limbs.
+     */
+    struct BigNumber {
+        bool negative;
+        Limbs limbs;
+    };
+
+    /**
+     * @brief A number in sign-magnitude form, used by the slow paths (the
+     * magnitude of 0 is empty)
+     */
+    struct Value {
+        bool negative;
+        Limbs magnitude;
+    };
+
+    BigNumber* big_number(const Integer::Word word) {
+        return (BigNumber*)(word & ~(Integer::Word)1);
+    }
+
+    Value value_of(const Integer::Word word) {
+        if (Integer::is_small(word)) {
+            int64_t value = Integer::small_value(word);
+            Value result = {value < 0, {}};
+            if (value != 0) {
+                result.magnitude.push_back(value < 0 ? 0 - (uint64_t)value
+                                                     : (uint64_t)value);
+            }
+            return result;
+        }
+
+        BigNumber* number = big_number(word);
+        return {number->negative, number->limbs};
+    }
+
+    void trim(Limbs& limbs) {
+        while (!limbs.empty() && limbs.back() == 0) { limbs.pop_back(); }
+    }
+
+    /**
+     * @brief Build the word of a number, in the smallest form
+     *
+     * @param negative The sign
+     * @param magnitude The magnitude
+     * @return Integer::Word The word (owning the big number, if any)
+     */
+    Integer::Word make(bool negative, Limbs&& magnitude) {
+        trim(magnitude);
+        if (magnitude.empty()) { return 0; }
+
+        // SMALL_MIN has a larger magnitude than SMALL_MAX
+        uint64_t limit = negative ? (uint64_t)Integer::SMALL_MAX + 1
+                                  : (uint64_t)Integer::SMALL_MAX;
+        if (magnitude.size() == 1 && magnitude[0] <= limit) {
+            int64_t value = negative ? (int64_t)(0 - magnitude[0])
+                                     : (int64_t)magnitude[0];
+            return Integer::small_word(value);
+        }
+
+        BigNumber* number = new BigNumber{negative, std::move(magnitude)};
+        return (Integer::Word)number | 1;
+    }
+
+    int compare(const Limbs& left, const Limbs& right) {
+        if (left.size() != right.size()) {
+            return left.size() < right.size() ? -1 : 1;
+        }
+        for (size_t i = left.size(); i > 0; --i) {
+            if (left[i - 1] != right[i - 1]) {
+                return left[i - 1] < right[i - 1] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    Limbs add(const Limbs& left, const Limbs& right) {
+        const Limbs& longer = left.size() >= right.size() ? left : right;
+        const Limbs& shorter = left.size() >= right.size() ? right : left;
+        Limbs sum(longer.size() + 1);
+        uint64_t carry = 0;
+
+        for (size_t i = 0; i < longer.size(); ++i) {
+            uint128_t total = (uint128_t)longer[i] + carry;
+            if (i < shorter.size()) { total += shorter[i]; }
+            sum[i] = (uint64_t)total;
+            carry = total >> 64;
+        }
+        sum[longer.size()] = carry;
+
+        return sum;
+    }
+
+    // left - right, where left >= right
+    Limbs subtract(const Limbs& left, const Limbs& right) {
+        Limbs difference(left.size());
+        uint64_t borrow = 0;
+
+        for (size_t i = 0; i < left.size(); ++i) {
+            uint64_t subtrahend = i < right.size() ? right[i] : 0;
+            uint128_t total = (uint128_t)left[i] - subtrahend - borrow;
+            difference[i] = (uint64_t)total;
+            borrow = (total >> 64) ? 1 : 0;
+        }
+
+        return difference;
+    }
+
+    // out[0, size) += value[0, count), the result must fit
+    void add_into(uint64_t* out, size_t size, const uint64_t* value,
+                  size_t count) {
+        uint64_t carry = 0;
+        size_t i = 0;
+
+        for (; i < count; ++i) {
+            uint128_t total = (uint128_t)out[i] + value[i] + carry;
+            out[i] = (uint64_t)total;
+            carry = total >> 64;
+        }
+        for (; carry != 0 && i < size; ++i) { carry = (++out[i] == 0); }
+    }
+
+    // out[0, size) -= value[0, count), the result must be positive
+    void subtract_from(uint64_t* out, size_t size, const uint64_t* value,
+                       size_t count) {
+        uint64_t borrow = 0;
+        size_t i = 0;
+
+        for (; i < count; ++i) {
+            uint128_t total = (uint128_t)out[i] - value[i] - borrow;
+            out[i] = (uint64_t)total;
+            borrow = (total >> 64) ? 1 : 0;
+        }
+        for (; borrow != 0 && i < size; ++i) { borrow = (out[i]-- == 0); }
+    }
+
+    // out[0, n + m) = a * b, out must be zeroed
+    void multiply_basecase(const uint64_t* a, size_t n, const uint64_t* b,
+                           size_t m, uint64_t* out) {
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < m; ++j) {
+                uint128_t total = (uint128_t)a[i] * b[j] + out[i + j] + carry;
+                out[i + j] = (uint64_t)total;
+                carry = total >> 64;
+            }
+            out[i + m] = carry;
+        }
+    }
+
+    void multiply(const uint64_t* a, size_t n, const uint64_t* b, size_t m,
+                  uint64_t* out);
+
+    // out[0, 2n) = a * b, where both have n limbs, out must be zeroed
+    void karatsuba(const uint64_t* a, const uint64_t* b, size_t n,
+                   uint64_t* out) {
+        // a = a1 * B^low + a0, b = b1 * B^low + b0
+        size_t low = n / 2;
+        size_t high = n - low;
+
+        // a0 * b0 and a1 * b1 are stored directly in their final positions
+        multiply(a, low, b, low, out);
+        multiply(a + low, high, b + low, high, out + 2 * low);
+
+        // (a0 + a1) * (b0 + b1) - a0 * b0 - a1 * b1 = a0 * b1 + a1 * b0
+        Limbs a_sum(high + 1, 0), b_sum(high + 1, 0);
+        std::copy(a + low, a + n, a_sum.begin());
+        std::copy(b + low, b + n, b_sum.begin());
+        add_into(a_sum.data(), high + 1, a, low);
+        add_into(b_sum.data(), high + 1, b, low);
+
+        Limbs middle(2 * high + 2, 0);
+        multiply(a_sum.data(), high + 1, b_sum.data(), high + 1,
+                 middle.data());
+        subtract_from(middle.data(), middle.size(), out, 2 * low);
+        subtract_from(middle.data(), middle.size(), out + 2 * low, 2 * high);
+        trim(middle);
+
+        add_into(out + low, 2 * n - low, middle.data(), middle.size());
+    }
+
+    // out[0, n + m) = a * b, out must be zeroed
+    void multiply(const uint64_t* a, size_t n, const uint64_t* b, size_t m,
+                  uint64_t* out) {
+        if (n < m) {
+            std::swap(a, b);
+            std::swap(n, m);
+        }
+
+        if (m < KARATSUBA_THRESHOLD) {
+            multiply_basecase(a, n, b, m, out);
+        } else if (n == m) {
+            karatsuba(a, b, n, out);
+        } else {
+            // Unbalanced, split the longer number into pieces of m limbs
+            Limbs product(2 * m);
+            for (size_t offset = 0; offset < n; offset += m) {
+                size_t size = std::min(m, n - offset);
+                std::fill(product.begin(), product.end(), 0);
+                multiply(a + offset, size, b, m, product.data());
+                add_into(out + offset, n + m - offset, product.data(),
+                         size + m);
+            }
+        }
+    }
+
+    Limbs multiply(const Limbs& left, const Limbs& right) {
+        if (left.empty() || right.empty()) { return {}; }
+
+        Limbs product(left.size() + right.size(), 0);
+        multiply(left.data(), left.size(), right.data(), right.size(),
+                 product.data());
+        return product;
+    }
+
+    /**
+     * @brief Divide (high * 2^64 + low) by divisor, where high < divisor
+     *
+     * @return uint64_t The quotient, the remainder is stored in remainder
+     */
+    inline uint64_t divide_wide(uint64_t high, uint64_t low, uint64_t divisor,
+                                uint64_t* remainder) {
+#if defined(__x86_64__)
+        uint64_t quotient;
+        __asm__("divq %4"
+                : "=a"(quotient), "=d"(*remainder)
+                : "a"(low), "d"(high), "rm"(divisor));
+        return quotient;
+#else
+        uint128_t dividend = ((uint128_t)high << 64) | low;
+        *remainder = dividend % divisor;
+        return dividend / divisor;
+#endif
+    }
+
+    /**
+     * @brief Get the largest power of the base that fits in a limb
+     *
+     * @param base The base
+     * @param digits The exponent
+     * @return uint64_t The power
+     */
+    uint64_t chunk_power(const int base, int* digits) {
+        const uint64_t limit = UINT64_MAX / base;
+        uint64_t power = base;
+        *digits = 1;
+
+        while (power <= limit) {
+            power *= base;
+            (*digits)++;
+        }
+
+        return power;
+    }
+
+    int digit_value(const char digit) {
+        if (digit >= '0' && digit <= '9') { return digit - '0'; }
+        if (digit >= 'A' && digit <= 'Z') { return digit - 'A' + 10; }
+        if (digit >= 'a' && digit <= 'z') { return digit - 'a' + 10; }
+        return INT32_MAX;
+    }
+}    // namespace
+
+Integer::Integer(const Word word, bool tag) : word(word) {}
+
+Integer::Integer() : word(0) {}
+
+Integer::Integer(const int64_t value) {
+    if (fits_small(value)) {
+        word = small_word(value);
+    } else {
+        uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : value;
+        word = make(value < 0, {magnitude});
+    }
+}
+
+Integer::Integer(const Integer& other) : word(copy(other.word)) {}
+
+Integer::Integer(Integer&& other) noexcept : word(other.word) {
+    other.word = 0;
+}
+
+Integer& Integer::operator=(const Integer& other) {
+    if (this != &other) {
+        destroy(word);
+        word = copy(other.word);
+    }
+    return *this;
+}
+
+Integer& Integer::operator=(Integer&& other) noexcept {
+    std::swap(word, other.word);
+    return *this;
+}
+
+Integer::~Integer() { destroy(word); }
+
+Integer Integer::adopt(const Word word) { return Integer(word, true); }
+
+Integer::Word Integer::release() {
+    Word released = word;
+    word = 0;
+    return released;
+}
+
+Integer::Word Integer::copy(const Word word) {
+    if (is_small(word)) { return word; }
+    return (Word) new BigNumber(*big_number(word)) | 1;
+}
+
+void Integer::destroy(const Word word) {
+    if (!is_small(word)) { delete big_number(word); }
+}
+
+bool Integer::equal(const Word left, const Word right) {
+    if (left == right) { return true; }
+    if (is_small(left) || is_small(right)) { return false; }
+
+    BigNumber* left_number = big_number(left);
+    BigNumber* right_number = big_number(right);
+    return left_number->negative == right_number->negative &&
+           left_number->limbs == right_number->limbs;
+}
+
+std::string Integer::to_string(const int base) const {
+    std::string digits = "";
+    Value value = value_of(word);
+
+    if (value.magnitude.empty()) { return "0"; }
+
+    // Each division by the chunk power gives a group of digits
+    int chunk_digits;
+    uint64_t power = chunk_power(base, &chunk_digits);
+    Limbs& magnitude = value.magnitude;
+
+    while (!magnitude.empty()) {
+        uint64_t remainder = 0;
+        for (size_t i = magnitude.size(); i > 0; --i) {
+            magnitude[i - 1] =
+                divide_wide(remainder, magnitude[i - 1], power, &remainder);
+        }
+        trim(magnitude);
+
+        // The most significant group has no leading zeros
+        for (int i = 0; i < chunk_digits; ++i) {
+            if (magnitude.empty() && remainder == 0) { break; }
+            digits += Helpers::charValue(remainder % base);
+            remainder /= base;
+        }
+    }
+
+    if (value.negative) { digits += '-'; }
+    std::reverse(digits.begin(), digits.end());
+
+    return digits;
+}
+
+Integer Integer::parse(const char* text, const size_t length, const int base,
+                       bool* valid) {
+    size_t start = (length > 0 && (text[0] == '-' || text[0] == '+'));
+    bool negative = start == 1 && text[0] == '-';
+
+    // The digits are validated while they are converted
+    *valid = length > start;
+    if (!*valid) { return Integer(); }
+
+    // Multiply by base^digits and add each group of digits, starting with
+    // the (shorter) most significant one
+    int chunk_digits;
+    chunk_power(base, &chunk_digits);
+    size_t group = (length - start) % chunk_digits;
+    if (group == 0) { group = chunk_digits; }
+
+    Limbs magnitude;
+    for (size_t i = start; i < length; i += group, group = chunk_digits) {
+        uint64_t power = 1, chunk = 0;
+        for (size_t j = i; j < i + group; ++j) {
+            int digit = digit_value(text[j]);
+            if (digit >= base) {
+                *valid = false;
+                return Integer();
+            }
+
+            power *= base;
+            chunk = chunk * base + digit;
+        }
+
+        // A single group is a 64-bit value, that is usually small
+        if (magnitude.empty() && i + group == length &&
+            chunk <= (uint64_t)INT64_MAX) {
+            return Integer(negative ? -(int64_t)chunk : (int64_t)chunk);
+        }
+
+        uint64_t carry = chunk;
+        for (auto& limb : magnitude) {
+            uint128_t total = (uint128_t)limb * power + carry;
+            limb = (uint64_t)total;
+            carry = total >> 64;
+        }
+        if (carry != 0) { magnitude.push_back(carry); }
+    }
+
+    return adopt(make(negative, std::move(magnitude)));
+}
+
+namespace Glypho::Core {
+    Integer operator+(const Integer& left, const Integer& right) {
+        // The sum of two small numbers always fits in 64 bits
+        if (Integer::is_small(left.word) && Integer::is_small(right.word)) {
+            return Integer(Integer::small_value(left.word) +
+                           Integer::small_value(right.word));
+        }
+
+        Value a = value_of(left.word);
+        Value b = value_of(right.word);
+
+        if (a.negative == b.negative) {
+            return Integer::adopt(
+                make(a.negative, add(a.magnitude, b.magnitude)));
+        }
+        if (compare(a.magnitude, b.magnitude) >= 0) {
+            return Integer::adopt(
+                make(a.negative, subtract(a.magnitude, b.magnitude)));
+        }
+        return Integer::adopt(
+            make(b.negative, subtract(b.magnitude, a.magnitude)));
+    }
+
+    Integer operator*(const Integer& left, const Integer& right) {
+        int64_t product;
+        if (Integer::is_small(left.word) && Integer::is_small(right.word) &&
+            !__builtin_mul_overflow(Integer::small_value(left.word),
+                                    Integer::small_value(right.word),
+                                    &product)) {
+            return Integer(product);
+        }
+
+        Value a = value_of(left.word);
+        Value b = value_of(right.word);
+
+        return Integer::adopt(make(a.negative != b.negative,
+                                   multiply(a.magnitude, b.magnitude)));
+    }
+
+    Integer operator-(const Integer& value) {
+        if (Integer::is_small(value.word)) {
+            return Integer(-Integer::small_value(value.word));
+        }
+
+        Value a = value_of(value.word);
+        return Integer::adopt(make(!a.negative, std::move(a.magnitude)));
+    }
+
+    bool operator==(const Integer& left, const Integer& right) {
+        return Integer::equal(left.word, right.word);
+    }
+
+    bool operator!=(const Integer& left, const Integer& right) {
+        return !Integer::equal(left.word, right.word);
+    }
+}    // namespace Glypho::Core
@@ -0,0 +1,232 @@
+/**
+ * @file Integer.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Integer, the arbitrary-precision numbers used by the
+ * Glypho stack
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Integer class
+     * An Integer is a single 64-bit word. Small numbers are stored inline,
+     * shifted left by one bit (so the lowest bit is 0), meaning they can be
+     * added, compared and copied like plain integers. Numbers that don't fit
+     * in 63 bits are promoted (after an overflow check) to a heap-allocated
+     * big number, with 64-bit limbs, and the word stores its address with the
+     * lowest bit set. A number is always stored in the smallest form, so two
+     * equal numbers always have the same kind.
+     * The stack stores the words directly, taking the ownership of the big
+     * numbers (adopt/release move it between an Integer and a word).
+     */
+    class Integer {
+       public:
+        typedef uint64_t Word;
+
+        // The range of the numbers stored inline
+        static const int64_t SMALL_MIN = INT64_MIN / 2;
+        static const int64_t SMALL_MAX = INT64_MAX / 2;
+
+       private:
+        Word word;
+
+        /**
+         * @brief Construct a new Integer object from a word (takes its
+         * ownership)
+         *
+         * @param word The word
+         * @param tag Unused, makes the constructor different from the others
+         */
+        Integer(const Word word, bool tag);
+
+       public:
+        /**
+         * @brief Construct a new Integer object
+         * Empty constructor, the value is 0
+         */
+        Integer();
+
+        /**
+         * @brief Construct a new Integer object from a 64-bit value
+         *
+         * @param value The value
+         */
+        Integer(const int64_t value);
+
+        /**
+         * @brief Copy-Constructs a new Integer object
+         *
+         * @param other The other Integer
+         */
+        Integer(const Integer& other);
+
+        /**
+         * @brief Move-Constructs a new Integer object (the other one becomes 0)
+         *
+         * @param other The other Integer
+         */
+        Integer(Integer&& other) noexcept;
+
+        /**
+         * @brief Assignment operator
+         *
+         * @param other The other object
+         * @return Integer& The new object
+         */
+        Integer& operator=(const Integer& other);
+
+        /**
+         * @brief Move assignment operator
+         *
+         * @param other The other object
+         * @return Integer& The new object
+         */
+        Integer& operator=(Integer&& other) noexcept;
+
+        /**
+         * @brief Destroy the Integer object
+         */
+        ~Integer();
+
+        /**
+         * @brief Check if a word stores a number inline
+         *
+         * @param word The word
+         * @return bool If the number is small
+         */
+        static bool is_small(const Word word) { return (word & 1) == 0; }
+
+        /**
+         * @brief Check if a value can be stored inline
+         *
+         * @param value The value
+         * @return bool If it fits
+         */
+        static bool fits_small(const int64_t value) {
+            return value >= SMALL_MIN && value <= SMALL_MAX;
+        }
+
+        /**
+         * @brief Get the word of a small number (it must fit)
+         *
+         * @param value The value
+         * @return Word The word
+         */
+        static Word small_word(const int64_t value) {
+            return (Word)value << 1;
+        }
+
+        /**
+         * @brief Get the value of a small number
+         *
+         * @param word The word (it must be small)
+         * @return int64_t The value
+         */
+        static int64_t small_value(const Word word) {
+            return (int64_t)word >> 1;
+        }
+
+        /**
+         * @brief Take the ownership of a word
+         *
+         * @param word The word
+         * @return Integer The number
+         */
+        static Integer adopt(const Word word);
+
+        /**
+         * @brief Give up the ownership of the word (the Integer becomes 0)
+         *
+         * @return Word The word
+         */
+        Word release();
+
+        /**
+         * @brief Copy the number stored in a word (without taking it)
+         *
+         * @param word The word
+         * @return Word A word with the same value, owning its own copy
+         */
+        static Word copy(const Word word);
+
+        /**
+         * @brief Free a word that is no longer used
+         *
+         * @param word The word
+         */
+        static void destroy(const Word word);
+
+        /**
+         * @brief Check if two words store the same number
+         *
+         * @param left The first word
+         * @param right The second word
+         * @return bool If the numbers are equal
+         */
+        static bool equal(const Word left, const Word right);
+
+        /**
+         * @brief Check if the number is 0
+         *
+         * @return bool If it is
+         */
+        bool is_zero() const { return word == 0; }
+
+        /**
+         * @brief Get the value of the number, if it is stored inline
+         *
+         * @param value Where the value is stored
+         * @return bool If the number is small
+         */
+        bool get_small(int64_t* value) const {
+            if (!is_small(word)) { return false; }
+            *value = small_value(word);
+            return true;
+        }
+
+        /**
+         * @brief Convert the number to a string, in the specified base. Big
+         * numbers are split into chunks of as many digits as fit in a limb,
+         * so there is a single division per chunk.
+         *
+         * @param base The base (at least 2)
+         * @return std::string The digits, with a minus for negative numbers
+         */
+        std::string to_string(const int base) const;
+
+        /**
+         * @brief Parse a number (an optional sign, followed by digits)
+         *
+         * @param text The number
+         * @param length The length of the text
+         * @param base The base (at least 2)
+         * @param valid Set to false if the text is not a valid number
+         * @return Integer The number (0 if it is not valid)
+         */
+        static Integer parse(const char* text, const size_t length,
+                             const int base, bool* valid);
+
+        /**
+         * @brief Parse a number (an optional sign, followed by digits)
+         *
+         * @param text The number
+         * @param base The base (at least 2)
+         * @param valid Set to false if the text is not a valid number
+         * @return Integer The number (0 if it is not valid)
+         */
+        static Integer parse(const std::string& text, const int base,
+                             bool* valid) {
+            return parse(text.data(), text.size(), base, valid);
+        }
+
+        friend Integer operator+(const Integer& left, const Integer& right);
+        friend Integer operator*(const Integer& left, const Integer& right);
+        friend Integer operator-(const Integer& value);
+        friend bool operator==(const Integer& left, const Integer& right);
+        friend bool operator!=(const Integer& left, const Integer& right);
+    };
+}    // namespace Glypho::Core
@@ -7,17 +7,107 @@
 
 #include "Interpreter.hpp"
 
+#include "Diagnostics.hpp"
+
 using namespace Glypho;
 
+namespace {
+    /**
+     * @brief Run a program one instruction at a time. The observer is told
+     * about every instruction, generated operation and loop; the NoProfiler
+     * ignores them, so this is also the reference engine.
+     *
+     * @param program The program
+     * @param glypho_stack The glypho stack the program uses
+     * @param base The base of the numbers that can be read from stdin
+     * @param observer The observer (a Profiler, or the NoProfiler)
+     */
+    template <typename Observer>
+    void run_instructions(const Core::Program& program,
+                          Core::Stack* glypho_stack, const int base,
+                          Observer* observer) {
+        using namespace Core;
+
+        Program::Index id = program.size() > 0 ? 0 : Program::END;
+
+        // END means there is no other instruction
+        while (id != Program::END) {
+            InstructionType type = program.type_at(id);
+            Program::Index next_id = program.next_at(id);
+            observer->step(id, type);
+
+            switch (type) {
+                case InstructionType::LBrace: {
+                    // Jump to associated RBrace if the top element is 0
+                    if (glypho_stack->TopIsZero(id)) {
+                        next_id = program.jump_at(id);
+                    } else {
+                        observer->iteration(id);
+                    }
+                } break;
+                case InstructionType::RBrace: {
+                    // Jump back to the associated LBrace if the top element
+                    // is not 0 (errors are reported for the LBrace)
+                    Program::Index start = program.jump_at(id);
+                    if (!glypho_stack->TopIsZero(start)) {
+                        next_id = start;
+                    } else {
+                        observer->leave(start);
+                    }
+                } break;
+                case InstructionType::Execute: {
+                    InstructionType generated =
+                        decode_generated(glypho_stack, id);
+                    observer->generated(generated);
+                    execute_operation(generated, glypho_stack, id, base);
+                } break;
+                default: {
+                    execute_operation(type, glypho_stack, id, base);
+                } break;
+            }
+
+            observer->stack(*glypho_stack);
+            id = next_id;
+        }
+    }
+
+    /**
+     * @brief Describe an error that stopped the program
+     *
+     * @param failure The error
+     * @return Status The status
+     */
+    Status failed(const Throwable::Failure& failure) {
+        return {failure.exit_code(), failure.get_category(),
+                failure.get_error(), failure.get_instruction(),
+                failure.what()};
+    }
+
+    /**
+     * @brief Describe a successful load or run
+     *
+     * @return Status The status
+     */
+    Status succeeded() { return {0, Throwable::Category::Argument, 0, -1, ""}; }
+}    // namespace
+
 Interpreter::Interpreter()
     : code_path(""),
       input_numbers_base(Constants::DEFAULT_INPUT_BASE),
-      code_loaded(false) {
+      code_loaded(false),
+      engine(Engine::Bytecode),
+      optimization_level(Constants::DEFAULT_OPTIMIZATION_LEVEL),
+      profile_path("") {
     glypho_stack = Core::Stack();
 }
 
 Interpreter::Interpreter(const std::string& path, const unsigned int base)
-    : code_path(path), input_numbers_base(base), code_loaded(false) {
+    : code_path(path),
+      input_numbers_base(base),
+      code_loaded(false),
+      engine(Engine::Bytecode),
+      optimization_level(Constants::DEFAULT_OPTIMIZATION_LEVEL),
+      profile_path("") {
     glypho_stack = Core::Stack();
 }
 
@@ -25,122 +115,162 @@ Interpreter::Interpreter(const Interpreter& other)
     : code_path(other.code_path),
       input_numbers_base(other.input_numbers_base),
       code_loaded(false),
+      engine(other.engine),
+      optimization_level(other.optimization_level),
+      profile_path(other.profile_path),
       glypho_stack(other.glypho_stack) {}
 
 Interpreter& Interpreter::operator=(const Interpreter& other) {
     this->code_path = other.code_path;
     this->input_numbers_base = other.input_numbers_base;
     this->code_loaded = false;
+    this->engine = other.engine;
+    this->optimization_level = other.optimization_level;
+    this->profile_path = other.profile_path;
     this->glypho_stack = other.glypho_stack;
 
     return *this;
 }
 
+void Interpreter::set_base(const unsigned int base) {
+    input_numbers_base = base;
+}
+
+void Interpreter::set_engine(const Engine engine) { this->engine = engine; }
+
+void Interpreter::set_optimization_level(const int level) {
+    optimization_level = level;
+}
+
+void Interpreter::set_profile(const std::string& path) { profile_path = path; }
+
 void Interpreter::load_program() {
-    // Read encoded instructions from the file
-    std::vector<std::string> e_instructions =
-        Core::InputParser::read_data(code_path);
-
-    // Initialise the space to store the instructions
-    int instruction_count = e_instructions.size();
-    program = std::vector<Core::Instruction>(instruction_count);
-
-    // Multithreaded instruction decoding
-    std::vector<std::thread> decoding_threads;
-
-    // Get the number of available threads (at least 1)
-    int thread_count =
-        std::max((unsigned int)1, std::thread::hardware_concurrency());
-
-    for (int thread_id = 0; thread_id < thread_count; ++thread_id) {
-        // Split the program into segments, once to each thread
-        int start = thread_id * (double)instruction_count / thread_count;
-        int end = std::min((int)(((long int)thread_id + 1) *
-                                 (double)instruction_count / thread_count),
-                           instruction_count);
-
-        // The thread function that decodes the instructions
-        auto decoder = [start, end, &e_instructions, &program = program]() {
-            for (int id = start; id < end; ++id) {
-                program.at(id) = Core::Instruction(e_instructions[id], id);
-            }
-        };
+    if (!Core::Glyc::is_compiled(code_path)) {
+        // Read the (decoded) instructions from the file
+        link(Core::InputParser::read_data(code_path));
+        return;
+    }
 
-        decoding_threads.push_back(std::thread(decoder));
+    // The compiled program is already linked and optimized
+    code_loaded = false;
+    Core::Glyc::load(code_path, &program, &bytecode, &initial_stack);
+
+    // The instruction engine runs the program from its start
+    if (engine == Engine::Reference || !profile_path.empty()) {
+        initial_stack = Core::Stack();
     }
+    finish_loading();
+}
 
-    // Wait for the decoding to finish
-    for (auto& thread : decoding_threads) { thread.join(); }
+void Interpreter::save_compiled(const std::string& path) const {
+    Helpers::MUST(code_loaded, "Error: No program was loaded\n");
+    Core::Glyc::save(path, program, bytecode, initial_stack);
+}
+
+Status Interpreter::load_source(const char* data, const size_t size) {
+    try {
+        link(Core::InputParser::read_memory(data, size));
+    } catch (const Throwable::Failure& failure) {
+        return failed(failure);
+    }
+    return succeeded();
+}
 
-    // Analyse the code for SyntaxErrors (braces matching)
-    // and "link" the instructions (set the id of the next instruction)
-    using namespace Throwable;
-    std::stack<long int> braces_stack;
+void Interpreter::link(std::vector<Core::InstructionType> instructions) {
+    // Analyse the code for SyntaxErrors (braces matching) and "link" the
+    // instructions. A previously loaded program is replaced.
+    code_loaded = false;
+    initial_stack = Core::Stack();
+    program = Core::Program(std::move(instructions));
 
-    for (auto& instruction : program) {
-        using namespace Core;
+    // Lower the linked program for the bytecode engine, and optimize it
+    // (profiles are collected by the instruction engine)
+    if (engine != Engine::Reference && profile_path.empty()) {
+        bytecode = Core::Optimizer::optimize(Core::Bytecode(program),
+                                             optimization_level);
 
-        InstructionType type = instruction.get_type();
-
-        if (type == InstructionType::LBrace) {
-            long int next_id = instruction.get_id() + 1;
-            instruction.set_next_id(next_id);
-
-            braces_stack.push(instruction.get_id());
-        } else if (type == InstructionType::RBrace) {
-            long int next_id = instruction.get_id() + 1;
-            instruction.set_next_id(next_id);
-
-            // Check if there are any opened braces
-            Helpers::MUST_NOT(braces_stack.empty(),
-                              message(SyntaxError::OPENING_BRACE_EXPECTED,
-                                      instruction.get_id()) +
-                                  "\n");
-
-            int block_start = braces_stack.top();
-            int block_end = instruction.get_id();
-            braces_stack.pop();
-
-            // Process code block (link the two braces)
-            instruction.set_jump_id(block_start);
-            program.at(block_start).set_jump_id(block_end);
-
-            if (next_id >= instruction_count) { instruction.set_next_id(-1); }
-        } else {
-            long int next_id = instruction.get_id() + 1;
-
-            // If we have not reached the end of the program
-            if (next_id < instruction_count) {
-                instruction.set_next_id(next_id);
-                instruction.set_jump_id(next_id);
-            } else {
-                instruction.set_next_id(-1);
-                instruction.set_jump_id(-1);
-            }
+        // Run the start of the program that does not depend on the input
+        if (optimization_level >= 1) {
+            Core::Optimizer::evaluate_prefix(bytecode, &initial_stack);
         }
     }
 
-    // Check that all braces are closed
-    Helpers::MUST(
-        braces_stack.empty(),
-        message(SyntaxError::CLOSING_BRACE_EXPECTED, instruction_count) + "\n");
+    finish_loading();
+}
+
+void Interpreter::finish_loading() {
+    // Compile the bytecode into native code
+    jit.reset();
+    if (engine == Engine::Jit && profile_path.empty()) {
+        jit = std::make_unique<Core::Jit>(bytecode);
+    }
 
     // The code is loaded, sa we can run it
+    glypho_stack = initial_stack;
     code_loaded = true;
 }
 
+const Core::Program& Interpreter::get_program() const {
+    return program;
+}
+
 void Interpreter::run_program() {
-    if (!code_loaded) exit(-1);
+    execute(&glypho_stack, input_numbers_base);
+}
 
-    // Start the program execution
-    long int instruction_id = 0;
-    uint64_t instructions_exec = 0;
-
-    // -1 instruction id means there is no other instruction
-    while (instruction_id != -1) {
-        instructions_exec++;
-        program.at(instruction_id)
-            .execute(&glypho_stack, &instruction_id, &program,
-                     input_numbers_base);
+Status Interpreter::run(const IO::Source& input, const IO::Sink& output) {
+    try {
+        Helpers::MUST(input_numbers_base > 1,
+                      "ArgumentError: Base '" +
+                          std::to_string(input_numbers_base) +
+                          "' is not a valid number\n");
+
+        // The output is passed to the sink when the redirect is destroyed,
+        // before the error is caught
+        IO::Redirect redirect(input, output);
+        execute(&glypho_stack, input_numbers_base);
+    } catch (const Throwable::Failure& failure) {
+        return failed(failure);
+    }
+    return succeeded();
+}
+
+void Interpreter::reset() { glypho_stack = initial_stack; }
+
+void Interpreter::run_shared(const unsigned int base) const {
+    // The stack may already hold the evaluated start of the program
+    Core::Stack stack(initial_stack);
+    execute(&stack, base);
+}
+
+void Interpreter::execute(Core::Stack* stack, const unsigned int base) const {
+    Helpers::MUST(code_loaded, "Error: No program was loaded\n");
+
+    if (!profile_path.empty()) {
+        Core::Profiler profiler(program, profile_path);
+
+        profiler.start();
+        run_instructions(program, stack, base, &profiler);
+        profiler.finish();
+        return;
+    }
+
+    if (engine == Engine::Bytecode) {
+        bytecode.run(stack, base);
+        return;
     }
-}
\ No newline at end of file
+
+    if (engine == Engine::Cached) {
+        bytecode.run_cached(stack, base);
+        return;
+    }
+
+    if (engine == Engine::Jit) {
+        jit->run(stack, base);
+        return;
+    }
+
+    // Start the program execution
+    Core::NoProfiler observer;
+    run_instructions(program, stack, base, &observer);
+}
@@ -7,19 +7,57 @@
 
 #pragma once
 
-#include <stack>
-#include <thread>
+#include <memory>
 #include <vector>
 
+#include "Bytecode.hpp"
+#include "Glyc.hpp"
 #include "Helpers.hpp"
 #include "InputParser.hpp"
+#include "IO.hpp"
 #include "Instruction.hpp"
+#include "Jit.hpp"
+#include "Optimizer.hpp"
+#include "Profiler.hpp"
+#include "Program.hpp"
 #include "Stack.hpp"
 
 namespace Glypho {
+    /**
+     * @brief The engines that can run a loaded program
+     *
+     */
+    enum class Engine {
+        Reference,    // Runs the instructions one by one
+        Bytecode,     // Runs the compact bytecode, with threaded dispatch
+        Cached,       // The same, keeping the top of the stack in a register
+        Jit           // Runs the bytecode compiled into native code
+    };
+
+    /**
+     * @brief The result of loading or running a program, for the embedding
+     * applications (nothing is printed, and the process is not stopped)
+     */
+    struct Status {
+        int exit_code;    // 0, or the exit code of the executable (-1, -2)
+        Throwable::Category category;    // What caused the error
+        int error;               // The SyntaxError / RuntimeException
+        long int instruction;    // The id of the instruction, or -1
+        std::string message;     // The message the executable prints
+
+        /**
+         * @brief Check if there was no error
+         *
+         * @return bool If the program was loaded / ran successfully
+         */
+        bool ok() const { return exit_code == 0; }
+    };
+
     /**
      * @brief Declaration for the Interpreter class
-     * This interpretor can only run code from files (can not do it in realtime)
+     * The program is loaded from a file or from memory, and then run with
+     * stdin / stdout or with the I/O of the caller. A loaded program can be
+     * run multiple times, resetting the stack between the runs.
      */
     class Interpreter {
        private:
@@ -28,10 +66,36 @@ namespace Glypho {
         unsigned int input_numbers_base;    // The base of the numbers that can
                                             // be read from stdin
         bool code_loaded;                   // If a program was loaded
+        Engine engine;    // The engine used to run the program
+        int optimization_level;    // The level of the bytecode optimizations
+        std::string profile_path;    // Where the profile is written (if any)
 
-        std::vector<Core::Instruction> program;
+        Core::Program program;
+        Core::Bytecode bytecode;
+        std::unique_ptr<Core::Jit> jit;
+        Core::Stack initial_stack;    // The stack after loading the program
         Core::Stack glypho_stack;
 
+        /**
+         * @brief Link, lower and optimize the decoded instructions
+         *
+         * @param instructions The instructions
+         */
+        void link(std::vector<Core::InstructionType> instructions);
+
+        /**
+         * @brief Prepare the loaded program for the selected engine
+         */
+        void finish_loading();
+
+        /**
+         * @brief Run the loaded program with the selected engine
+         *
+         * @param stack The stack the program uses
+         * @param base The base of the numbers that can be read from stdin
+         */
+        void execute(Core::Stack* stack, const unsigned int base) const;
+
        public:
         /**
          * @brief Construct a new Interpreter object
@@ -64,15 +128,98 @@ namespace Glypho {
         Interpreter& operator=(const Interpreter& other);
 
         /**
-         * @brief Loads the program code, decodes it and checks syntax.
+         * @brief Set the base of the numbers that can be read from the input
+         *
+         * @param base The base (checked when the program is run)
+         */
+        void set_base(const unsigned int base);
+
+        /**
+         * @brief Select the engine used to run the program
+         *
+         * @param engine The engine
+         */
+        void set_engine(const Engine engine);
+
+        /**
+         * @brief Select the optimization level for the bytecode engine
+         *
+         * @param level The level (0 - no optimizations)
+         */
+        void set_optimization_level(const int level);
+
+        /**
+         * @brief Profile the program, writing the statistics as JSON. The
+         * profiled program is run one instruction at a time (whatever the
+         * engine), so the statistics use the ids of the source instructions.
+         *
+         * @param path Where the profile is written (empty to disable it)
+         */
+        void set_profile(const std::string& path);
+
+        /**
+         * @brief Loads the program code, decodes it and checks syntax. A
+         * compiled program (see save_compiled) is mapped instead, and is run
+         * with the optimizations it was compiled with.
          *
          */
         void load_program();
 
+        /**
+         * @brief Write the loaded program as a compiled program (.glyc). It
+         * must be loaded for the bytecode engine, without profiling.
+         *
+         * @param path The path of the compiled program
+         */
+        void save_compiled(const std::string& path) const;
+
+        /**
+         * @brief Load a program from memory (the engine, the optimization
+         * level and the profile must be set before it)
+         *
+         * @param data The source code
+         * @param size The size of the source code
+         * @return Status The SyntaxError, if the program is not valid
+         */
+        Status load_source(const char* data, const size_t size);
+
+        /**
+         * @brief Get the loaded program (after linking)
+         *
+         * @return const Core::Program& The program
+         */
+        const Core::Program& get_program() const;
+
         /**
          * @brief Run the loaded program code
          *
          */
         void run_program();
+
+        /**
+         * @brief Run the loaded program, with the I/O of the caller. The run
+         * continues from the current stack (see reset).
+         *
+         * @param input Supplies the input
+         * @param output Receives the output (before any error is returned)
+         * @return Status The exception that stopped the program, if any
+         */
+        Status run(const IO::Source& input, const IO::Sink& output);
+
+        /**
+         * @brief Bring the stack back to its state after the program was
+         * loaded, so the program can be run again
+         */
+        void reset();
+
+        /**
+         * @brief Run the loaded program on a copy of its initial stack, with
+         * the specified base. The interpreter does not change, so a loaded
+         * program can be run by multiple threads at once (each one with its
+         * own I/O, see IO::Redirect).
+         *
+         * @param base The base of the numbers that can be read from stdin
+         */
+        void run_shared(const unsigned int base) const;
     };
 }    // namespace Glypho
\ No newline at end of file
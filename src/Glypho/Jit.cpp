@@ -0,0 +1,751 @@
+/**
+ * @file Jit.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Jit, and the x86-64 code generator it uses
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Jit.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <utility>
+
+#include "Diagnostics.hpp"
+
+// The generated code uses the System V calling convention
+#if defined(__x86_64__) && defined(__unix__)
+#define GLYPHO_JIT 1
+#include <sys/mman.h>
+#else
+#define GLYPHO_JIT 0
+#endif
+
+using namespace Glypho::Core;
+using Glypho::Throwable::RuntimeException;
+
+namespace {
+    enum Register : uint8_t {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    enum Condition : uint8_t {
+        OVERFLOW = 0x0,
+        BELOW = 0x2,
+        EQUAL = 0x4,
+        NOT_EQUAL = 0x5,
+        ABOVE = 0x7
+    };
+
+    // The registers of the native code (all of them are callee-saved)
+    const Register BUFFER = RBX;       // The ring buffer
+    const Register MASK = R12;         // capacity - 1
+    const Register TOP = R13;          // The index of the top element
+    const Register COUNT = R14;        // The number of elements
+    const Register REGISTERS = R15;    // Where the registers are saved
+    const Register CONTEXT = RBP;      // The argument of the helpers
+
+    /**
+     * @brief A minimal assembler, for the few instructions the Jit uses. All
+     * the operations are on 64-bit registers.
+     */
+    class Assembler {
+       private:
+        std::vector<int64_t> labels;    // Their offsets (-1 if not bound)
+        std::vector<std::pair<size_t, size_t>> fixups;    // rel32 -> label
+
+        void rex(uint8_t reg, uint8_t index, uint8_t base) {
+            emit(0x48 | ((reg & 8) >> 1) | ((index & 8) >> 2) |
+                 ((base & 8) >> 3));
+        }
+
+        void rel32(size_t label) {
+            fixups.push_back({bytes.size(), label});
+            emit32(0);
+        }
+
+       public:
+        std::vector<uint8_t> bytes;
+
+        void emit(uint8_t byte) { bytes.push_back(byte); }
+
+        void emit32(uint32_t value) {
+            for (int i = 0; i < 4; ++i) { emit(value >> (8 * i)); }
+        }
+
+        size_t new_label() {
+            labels.push_back(-1);
+            return labels.size() - 1;
+        }
+
+        void bind(size_t label) { labels[label] = bytes.size(); }
+
+        // opcode r/m, reg (both registers)
+        void op(uint8_t opcode, Register rm, Register reg) {
+            rex(reg, 0, rm);
+            emit(opcode);
+            emit(0xC0 | (reg & 7) << 3 | (rm & 7));
+        }
+
+        void mov(Register dst, Register src) { op(0x89, dst, src); }
+        void add(Register dst, Register src) { op(0x01, dst, src); }
+        void sub(Register dst, Register src) { op(0x29, dst, src); }
+        void and_(Register dst, Register src) { op(0x21, dst, src); }
+        void cmp(Register left, Register right) { op(0x39, left, right); }
+        void test(Register left, Register right) { op(0x85, left, right); }
+        void or_(Register dst, Register src) { op(0x09, dst, src); }
+
+        void imul(Register dst, Register src) {
+            rex(dst, 0, src);
+            emit(0x0F);
+            emit(0xAF);
+            emit(0xC0 | (dst & 7) << 3 | (src & 7));
+        }
+
+        // Group 3 operation on a register (0 - test with imm32, 3 - neg)
+        void unary(uint8_t extension, Register rm) {
+            rex(0, 0, rm);
+            emit(0xF7);
+            emit(0xC0 | extension << 3 | (rm & 7));
+        }
+
+        void test_imm(Register rm, int32_t imm) {
+            unary(0, rm);
+            emit32(imm);
+        }
+
+        // Shift right by 1, keeping the sign
+        void sar(Register rm) {
+            rex(0, 0, rm);
+            emit(0xD1);
+            emit(0xF8 | (rm & 7));
+        }
+
+        // Group 1 operation with an immediate (0 - add, 5 - sub, 7 - cmp)
+        void op_imm(uint8_t extension, Register rm, int32_t imm) {
+            rex(0, 0, rm);
+            if (imm >= INT8_MIN && imm <= INT8_MAX) {
+                emit(0x83);
+                emit(0xC0 | extension << 3 | (rm & 7));
+                emit(imm);
+            } else {
+                emit(0x81);
+                emit(0xC0 | extension << 3 | (rm & 7));
+                emit32(imm);
+            }
+        }
+
+        void mov_imm(Register dst, int64_t imm) {
+            if (imm >= INT32_MIN && imm <= INT32_MAX) {
+                rex(0, 0, dst);
+                emit(0xC7);
+                emit(0xC0 | (dst & 7));
+                emit32(imm);
+            } else {
+                rex(0, 0, dst);
+                emit(0xB8 + (dst & 7));
+                for (int i = 0; i < 8; ++i) { emit((uint64_t)imm >> (8 * i)); }
+            }
+        }
+
+        // opcode on [BUFFER + index * 8], the element at that index
+        void element(std::initializer_list<uint8_t> opcode, uint8_t reg,
+                     Register index) {
+            rex(reg, index, BUFFER);
+            for (uint8_t byte : opcode) { emit(byte); }
+            emit(0x04 | (reg & 7) << 3);
+            emit(0xC0 | (index & 7) << 3 | (BUFFER & 7));
+        }
+
+        // opcode on [base + offset] (base can not be RSP or R12)
+        void field(uint8_t opcode, Register reg, Register base,
+                   int32_t offset) {
+            rex(reg, 0, base);
+            emit(opcode);
+            emit(0x80 | (reg & 7) << 3 | (base & 7));
+            emit32(offset);
+        }
+
+        void jump(size_t label) {
+            emit(0xE9);
+            rel32(label);
+        }
+
+        void jump_if(Condition condition, size_t label) {
+            emit(0x0F);
+            emit(0x80 | condition);
+            rel32(label);
+        }
+
+        void call(Register target) {
+            if (target & 8) { emit(0x41); }
+            emit(0xFF);
+            emit(0xD0 | (target & 7));
+        }
+
+        void push(Register reg) {
+            if (reg & 8) { emit(0x41); }
+            emit(0x50 + (reg & 7));
+        }
+
+        void pop(Register reg) {
+            if (reg & 8) { emit(0x41); }
+            emit(0x58 + (reg & 7));
+        }
+
+        void ret() { emit(0xC3); }
+
+        /**
+         * @brief Resolve the jumps, after all the labels were bound
+         */
+        void link() {
+            for (auto& fixup : fixups) {
+                int32_t offset = labels[fixup.second] - (fixup.first + 4);
+                std::memcpy(&bytes[fixup.first], &offset, 4);
+            }
+        }
+    };
+}    // namespace
+
+namespace Glypho::Core {
+    /**
+     * @brief Translates the bytecode into native code. The program is
+     * emitted first, followed by the cold stubs (errors, buffer growth and
+     * the operations on big numbers, or the ones that overflow).
+     */
+    class Compiler {
+       private:
+        Assembler assembler;
+        const Bytecode& code;
+        std::vector<size_t> pc_labels;    // The label of each opcode
+        size_t exit_label;                // Returns the status in RAX
+        bool safe;    // If the checks of the current opcode can never fail
+        std::map<uint64_t, size_t> errors;    // The stub for each status
+
+        // A cold stub, that calls a helper and continues the program
+        struct Stub {
+            size_t label;
+            size_t back;    // Where the program continues
+            Jit::Helper helper;
+            int64_t arg;
+            uint32_t id;
+        };
+        std::vector<Stub> stubs;
+
+        void save() {
+            assembler.field(0x89, TOP, REGISTERS,
+                            offsetof(Jit::Registers, top));
+            assembler.field(0x89, COUNT, REGISTERS,
+                            offsetof(Jit::Registers, count));
+        }
+
+        void restore() {
+            assembler.field(0x8B, BUFFER, REGISTERS,
+                            offsetof(Jit::Registers, buffer));
+            assembler.field(0x8B, MASK, REGISTERS,
+                            offsetof(Jit::Registers, mask));
+            assembler.field(0x8B, TOP, REGISTERS,
+                            offsetof(Jit::Registers, top));
+            assembler.field(0x8B, COUNT, REGISTERS,
+                            offsetof(Jit::Registers, count));
+        }
+
+        // Call a helper, the result is in RAX
+        void call(Jit::Helper helper, int64_t arg, uint32_t id) {
+            save();
+            assembler.mov(RDI, CONTEXT);
+            assembler.mov_imm(RSI, arg);
+            assembler.mov_imm(RDX, id);
+            assembler.mov_imm(RAX, (int64_t)helper);
+            assembler.call(RAX);
+            restore();
+        }
+
+        // Call a helper that can fail, stopping the program if it does
+        void call_checked(Jit::Helper helper, int64_t arg, uint32_t id) {
+            call(helper, arg, id);
+            assembler.test(RAX, RAX);
+            assembler.jump_if(NOT_EQUAL, exit_label);
+        }
+
+        // Stop the program if the stack has less than size elements (safe
+        // opcodes are not checked)
+        void require(uint8_t size, RuntimeException exception, uint32_t id) {
+            if (safe) { return; }
+
+            uint64_t status = ((uint64_t)exception + 2) << 32 | id;
+            auto stub = errors.find(status);
+            if (stub == errors.end()) {
+                stub = errors.emplace(status, assembler.new_label()).first;
+            }
+
+            assembler.op_imm(7, COUNT, size);
+            assembler.jump_if(BELOW, stub->second);
+        }
+
+        // Create a cold stub, the back label is bound by the caller
+        size_t stub(Jit::Helper helper, int64_t arg, uint32_t id,
+                    size_t back) {
+            size_t label = assembler.new_label();
+            stubs.push_back({label, back, helper, arg, id});
+            return label;
+        }
+
+        // Run an operation with the interpreter, from a cold stub
+        size_t slow_path(InstructionType type, uint32_t id, size_t back) {
+            return stub(Jit::operation, (int64_t)type, id, back);
+        }
+
+        // Jump to a label if a word (or both) stores a big number
+        void jump_if_big(Register word, size_t label) {
+            assembler.test_imm(word, 1);
+            assembler.jump_if(NOT_EQUAL, label);
+        }
+
+        void jump_if_big(Register left, Register right, size_t label) {
+            assembler.mov(RSI, left);
+            assembler.or_(RSI, right);
+            jump_if_big(RSI, label);
+        }
+
+        // Make sure there is space for another element
+        void reserve_one() {
+            size_t back = assembler.new_label();
+
+            assembler.cmp(COUNT, MASK);
+            assembler.jump_if(ABOVE, stub(Jit::grow, 0, 0, back));
+            assembler.bind(back);
+        }
+
+        void increment_top() {
+            assembler.op_imm(0, TOP, 1);
+            assembler.and_(TOP, MASK);
+            assembler.op_imm(0, COUNT, 1);
+        }
+
+        void decrement_top() {
+            assembler.op_imm(5, TOP, 1);
+            assembler.and_(TOP, MASK);
+            assembler.op_imm(5, COUNT, 1);
+        }
+
+        // RCX = the index of the bottom element
+        void bottom_index() {
+            assembler.mov(RCX, TOP);
+            assembler.sub(RCX, COUNT);
+            assembler.op_imm(0, RCX, 1);
+            assembler.and_(RCX, MASK);
+        }
+
+        void push_constant(int64_t value, uint32_t id) {
+            // The big numbers are created by the interpreter
+            if (!Integer::fits_small(value)) {
+                call_checked(Jit::push_constant, value, id);
+                return;
+            }
+
+            int64_t word = Integer::small_word(value);
+            reserve_one();
+            increment_top();
+            if (word >= INT32_MIN && word <= INT32_MAX) {
+                assembler.element({0xC7}, 0, TOP);
+                assembler.emit32(word);
+            } else {
+                assembler.mov_imm(RAX, word);
+                assembler.element({0x89}, RAX, TOP);
+            }
+        }
+
+        void dup(uint32_t id) {
+            size_t back = assembler.new_label();
+
+            require(1, RuntimeException::EMPTY_STACK, id);
+            reserve_one();
+            assembler.element({0x8B}, RAX, TOP);
+            jump_if_big(RAX, slow_path(InstructionType::Dup, id, back));
+            increment_top();
+            assembler.element({0x89}, RAX, TOP);
+            assembler.bind(back);
+        }
+
+        // The operations on two small numbers, RCX = the index of the
+        // second element and RDX = its word
+        void binary(InstructionType type, uint32_t id) {
+            size_t back = assembler.new_label();
+            size_t slow = slow_path(type, id, back);
+
+            require(2, RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+            assembler.element({0x8B}, RAX, TOP);
+            assembler.mov(RCX, TOP);
+            assembler.op_imm(5, RCX, 1);
+            assembler.and_(RCX, MASK);
+            assembler.element({0x8B}, RDX, RCX);
+            jump_if_big(RAX, RDX, slow);
+
+            if (type == InstructionType::Add) {
+                // The sum of two words is the word of the sum
+                assembler.add(RDX, RAX);
+            } else {
+                // Only one of the factors keeps its tag
+                assembler.sar(RAX);
+                assembler.imul(RDX, RAX);
+            }
+            assembler.jump_if(OVERFLOW, slow);
+
+            assembler.element({0x89}, RDX, RCX);
+            decrement_top();
+            assembler.bind(back);
+        }
+
+        // Compare the top element with 0
+        void test_top() {
+            assembler.element({0x83}, 7, TOP);
+            assembler.emit(0);
+        }
+
+        void compile(long int pc) {
+            Opcode opcode = code.opcode_at(pc);
+            int64_t arg = code.argument_at(pc);
+            uint32_t id = code.source_at(pc);
+            safe = code.is_safe(pc);
+
+            switch (opcode) {
+                case Opcode::NOP: break;
+                case Opcode::Input: {
+                    call_checked(Jit::input, 0, id);
+                } break;
+                case Opcode::Rot: {
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    assembler.element({0x8B}, RAX, TOP);
+                    assembler.op_imm(5, TOP, 1);
+                    assembler.and_(TOP, MASK);
+                    bottom_index();
+                    assembler.element({0x89}, RAX, RCX);
+                } break;
+                case Opcode::Swap: {
+                    require(2, RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+                    assembler.mov(RCX, TOP);
+                    assembler.op_imm(5, RCX, 1);
+                    assembler.and_(RCX, MASK);
+                    assembler.element({0x8B}, RAX, TOP);
+                    assembler.element({0x8B}, RDX, RCX);
+                    assembler.element({0x89}, RDX, TOP);
+                    assembler.element({0x89}, RAX, RCX);
+                } break;
+                case Opcode::Push: {
+                    push_constant(1, id);
+                } break;
+                case Opcode::RRot: {
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    bottom_index();
+                    assembler.element({0x8B}, RAX, RCX);
+                    assembler.op_imm(0, TOP, 1);
+                    assembler.and_(TOP, MASK);
+                    assembler.element({0x89}, RAX, TOP);
+                } break;
+                case Opcode::Dup: {
+                    dup(id);
+                } break;
+                case Opcode::Add: {
+                    binary(InstructionType::Add, id);
+                } break;
+                case Opcode::LBrace: {
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    test_top();
+                    assembler.jump_if(EQUAL, pc_labels[arg]);
+                } break;
+                case Opcode::Output: {
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    call_checked(Jit::output, 0, id);
+                } break;
+                case Opcode::Multiply: {
+                    binary(InstructionType::Multiply, id);
+                } break;
+                case Opcode::Execute: {
+                    call_checked(Jit::execute, 0, id);
+                } break;
+                case Opcode::Negate: {
+                    size_t back = assembler.new_label();
+                    size_t slow = slow_path(InstructionType::Negate, id, back);
+
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    assembler.element({0x8B}, RAX, TOP);
+                    jump_if_big(RAX, slow);
+                    assembler.unary(3, RAX);
+                    assembler.jump_if(OVERFLOW, slow);
+                    assembler.element({0x89}, RAX, TOP);
+                    assembler.bind(back);
+                } break;
+                case Opcode::Pop: {
+                    // The big numbers must be freed
+                    size_t back = assembler.new_label();
+
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    assembler.element({0x8B}, RAX, TOP);
+                    jump_if_big(RAX, slow_path(InstructionType::Pop, id, back));
+                    decrement_top();
+                    assembler.bind(back);
+                } break;
+                case Opcode::RBrace: {
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    test_top();
+                    assembler.jump_if(NOT_EQUAL, pc_labels[arg]);
+                } break;
+                case Opcode::Halt: {
+                    assembler.mov_imm(RAX, Jit::HALTED);
+                    assembler.jump(exit_label);
+                } break;
+                case Opcode::Raise: {
+                    assembler.mov_imm(RAX, ((uint64_t)arg + 2) << 32 | id);
+                    assembler.jump(exit_label);
+                } break;
+                case Opcode::PushConst: {
+                    push_constant(arg, id);
+                } break;
+                case Opcode::AddConst: {
+                    require(1, RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+                    if (!Integer::fits_small(arg)) {
+                        call_checked(Jit::add_constant, arg, id);
+                        break;
+                    }
+
+                    size_t back = assembler.new_label();
+                    size_t slow = stub(Jit::add_constant, arg, id, back);
+
+                    assembler.element({0x8B}, RAX, TOP);
+                    jump_if_big(RAX, slow);
+                    assembler.mov_imm(RDX, Integer::small_word(arg));
+                    assembler.add(RAX, RDX);
+                    assembler.jump_if(OVERFLOW, slow);
+                    assembler.element({0x89}, RAX, TOP);
+                    assembler.bind(back);
+                } break;
+                case Opcode::RotN: {
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    call(Jit::rotate, arg, id);
+                } break;
+                case Opcode::DupLBrace: {
+                    dup(id);
+                    test_top();
+                    assembler.jump_if(EQUAL, pc_labels[arg]);
+                } break;
+                case Opcode::Loop: {
+                    const LoopInfo& loop = code.loop_at(arg);
+                    require(1, RuntimeException::EMPTY_STACK, id);
+                    test_top();
+                    assembler.jump_if(EQUAL, pc_labels[loop.exit]);
+
+                    // The helper returns FINISHED if the kernel ran the whole
+                    // loop, or FAILED
+                    call(Jit::loop, arg, id);
+                    assembler.op_imm(7, RAX, Jit::FAILED);
+                    assembler.jump_if(EQUAL, exit_label);
+                    assembler.test(RAX, RAX);
+                    assembler.jump_if(NOT_EQUAL, pc_labels[loop.exit]);
+                    assembler.jump(pc_labels[loop.body]);
+                } break;
+            }
+        }
+
+       public:
+        explicit Compiler(const Bytecode& code) : code(code), safe(false) {}
+
+        std::vector<uint8_t> compile() {
+            for (long int pc = 0; pc <= code.size(); ++pc) {
+                pc_labels.push_back(assembler.new_label());
+            }
+            exit_label = assembler.new_label();
+
+            // Save the callee-saved registers (the stack stays aligned to
+            // 16 bytes for the calls) and load the state of the stack
+            const Register saved[] = {RBX, RBP, R12, R13, R14, R15};
+            for (Register reg : saved) { assembler.push(reg); }
+            assembler.op_imm(5, RSP, 8);
+            assembler.mov(REGISTERS, RDI);
+            assembler.mov(CONTEXT, RSI);
+            restore();
+
+            // Skip the evaluated start of the program
+            if (code.entry_point() != 0) {
+                assembler.jump(pc_labels[code.entry_point()]);
+            }
+
+            // The program, ending with the Halt
+            for (long int pc = 0; pc <= code.size(); ++pc) {
+                assembler.bind(pc_labels[pc]);
+                compile(pc);
+            }
+
+            // The cold stubs
+            for (auto& stub : stubs) {
+                assembler.bind(stub.label);
+                call_checked(stub.helper, stub.arg, stub.id);
+                assembler.jump(stub.back);
+            }
+            for (auto& error : errors) {
+                assembler.bind(error.second);
+                assembler.mov_imm(RAX, error.first);
+                assembler.jump(exit_label);
+            }
+
+            assembler.bind(exit_label);
+            save();
+            assembler.op_imm(0, RSP, 8);
+            for (int i = 5; i >= 0; --i) { assembler.pop(saved[i]); }
+            assembler.ret();
+
+            assembler.link();
+            return assembler.bytes;
+        }
+    };
+}    // namespace Glypho::Core
+
+void Jit::store(Context* context) {
+    Registers& registers = context->registers;
+    Stack* glypho_stack = context->glypho_stack;
+
+    glypho_stack->count = registers.count;
+    glypho_stack->head =
+        (registers.top - registers.count + 1) & registers.mask;
+}
+
+void Jit::load(Context* context) {
+    Registers& registers = context->registers;
+    Stack* glypho_stack = context->glypho_stack;
+
+    registers.buffer = glypho_stack->buffer.data();
+    registers.mask = glypho_stack->mask;
+    registers.count = glypho_stack->count;
+    registers.top = (glypho_stack->head + glypho_stack->count - 1) &
+                    glypho_stack->mask;
+}
+
+template <typename Operation>
+uint64_t Jit::guarded(Context* context, Operation operation) {
+    uint64_t status = HALTED;
+
+    store(context);
+    try {
+        operation();
+    } catch (...) {
+        context->error = std::current_exception();
+        status = FAILED;
+    }
+    load(context);
+
+    return status;
+}
+
+uint64_t Jit::grow(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context]() { context->glypho_stack->grow(); });
+}
+
+uint64_t Jit::rotate(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context, arg, id]() {
+        context->glypho_stack->RotateBy(arg, id);
+    });
+}
+
+uint64_t Jit::operation(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context, arg, id]() {
+        execute_operation((InstructionType)arg, context->glypho_stack, id,
+                          context->base);
+    });
+}
+
+uint64_t Jit::push_constant(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context,
+                   [context, arg]() { context->glypho_stack->Input(arg); });
+}
+
+uint64_t Jit::add_constant(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context, arg, id]() {
+        context->glypho_stack->AddConstant(arg, id);
+    });
+}
+
+uint64_t Jit::input(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context, id]() {
+        context->glypho_stack->Input(Helpers::readNumber(context->base, id));
+    });
+}
+
+uint64_t Jit::output(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context, id]() {
+        Helpers::printNumber(context->base, context->glypho_stack->Output(id));
+    });
+}
+
+uint64_t Jit::execute(Context* context, int64_t arg, uint32_t id) {
+    return guarded(context, [context, id]() {
+        execute_generated(context->glypho_stack, id, context->base);
+    });
+}
+
+uint64_t Jit::loop(Context* context, int64_t arg, uint32_t id) {
+    // The kernels only do arithmetic on small numbers, but getting one can
+    // allocate (it is compiled and cached the first time it is used)
+    bool finished = false;
+    uint64_t status = guarded(context, [context, arg, &finished]() {
+        const LoopKernel& kernel = (*context->kernels)[arg].get(
+            *context->code, context->code->loop_at(arg),
+            context->glypho_stack->Size());
+        finished = kernel.run(context->glypho_stack);
+    });
+
+    return (status == HALTED && finished) ? FINISHED : status;
+}
+
+bool Jit::supported() { return GLYPHO_JIT; }
+
+Jit::Jit(const Bytecode& code)
+    : code(code), memory(nullptr), memory_size(0), function(nullptr) {
+#if GLYPHO_JIT
+    std::vector<uint8_t> native = Compiler(code).compile();
+
+    // Write the code, then make it executable (but not writable)
+    memory_size = native.size();
+    void* mapped = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) { return; }
+
+    memory = (uint8_t*)mapped;
+    std::memcpy(memory, native.data(), memory_size);
+    if (mprotect(memory, memory_size, PROT_READ | PROT_EXEC) != 0) { return; }
+
+    function = (Function)memory;
+#endif
+}
+
+Jit::~Jit() {
+#if GLYPHO_JIT
+    if (memory != nullptr) { munmap(memory, memory_size); }
+#endif
+}
+
+void Jit::run(Stack* glypho_stack, const int base) const {
+    // Not supported, use the bytecode engine
+    if (function == nullptr) {
+        code.run(glypho_stack, base);
+        return;
+    }
+
+    std::vector<LoopKernels> kernels(code.loop_count());
+    Context context;
+    context.glypho_stack = glypho_stack;
+    context.code = &code;
+    context.kernels = &kernels;
+    context.base = base;
+    load(&context);
+
+    uint64_t status = function(&context.registers, &context);
+    store(&context);
+
+    if (status == FAILED) { std::rethrow_exception(context.error); }
+    if (status != HALTED) {
+        Diagnostics::raise(RuntimeException((status >> 32) - 2),
+                           status & UINT32_MAX);
+    }
+}
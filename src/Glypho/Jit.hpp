@@ -0,0 +1,144 @@
+/**
+ * @file Jit.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Jit, which translates the bytecode of a program into
+ * native x86-64 code
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Loops.hpp"
+#include "Stack.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Jit class
+     * Every opcode is translated into a few native instructions, working
+     * directly on the ring buffer of the stack (its state is kept in
+     * registers). The jumps of the braces become native jumps, and the stack
+     * checks jump to cold stubs, placed after the program, that stop it with
+     * the same exception as the bytecode engine. Only the small Integers are
+     * handled inline: the big numbers, and the operations that overflow, are
+     * passed to the interpreter from cold stubs, like the I/O, executes,
+     * multiple rotations and the loop kernels.
+     * On other platforms (or if the code can not be mapped as executable),
+     * the bytecode engine is used instead.
+     */
+    class Jit {
+       private:
+        /**
+         * @brief The state of the stack, kept in registers by the native code
+         */
+        struct Registers {
+            Integer::Word* buffer;
+            uint64_t mask;
+            uint64_t top;    // The index of the top element
+            uint64_t count;
+        };
+
+        /**
+         * @brief The state used by the functions called from the native code
+         */
+        struct Context {
+            Registers registers;
+            Stack* glypho_stack;
+            const Bytecode* code;
+            std::vector<LoopKernels>* kernels;
+            int base;
+            std::exception_ptr error;    // Thrown by a called function
+        };
+
+        typedef uint64_t (*Function)(Registers*, Context*);
+        typedef uint64_t (*Helper)(Context*, int64_t, uint32_t);
+
+        // The status returned by the native code. A RuntimeException is
+        // returned as ((exception + 2) << 32) | id.
+        static const uint64_t HALTED = 0;
+        static const uint64_t FAILED = 1;    // The error is in the context
+
+        // Returned by the loop helper, if its kernel ran the whole loop
+        static const uint64_t FINISHED = 2;
+
+        Bytecode code;
+        uint8_t* memory;    // The executable memory
+        size_t memory_size;
+        Function function;    // The compiled program, null if not supported
+
+        friend class Compiler;
+
+        /**
+         * @brief Copy the registers into the stack, before calling a function
+         *
+         * @param context The context
+         */
+        static void store(Context* context);
+
+        /**
+         * @brief Load the registers from the stack, after calling a function
+         *
+         * @param context The context
+         */
+        static void load(Context* context);
+
+        /**
+         * @brief Run an operation on the stack, catching its exceptions (they
+         * can not pass through the native code)
+         *
+         * @param context The context
+         * @param operation The operation
+         * @return uint64_t HALTED if it succeeded, or FAILED
+         */
+        template <typename Operation>
+        static uint64_t guarded(Context* context, Operation operation);
+
+        // The functions called from the native code. They receive the
+        // argument of the opcode and its source id.
+        static uint64_t grow(Context* context, int64_t arg, uint32_t id);
+        static uint64_t rotate(Context* context, int64_t arg, uint32_t id);
+        static uint64_t operation(Context* context, int64_t arg, uint32_t id);
+        static uint64_t push_constant(Context* context, int64_t arg,
+                                      uint32_t id);
+        static uint64_t add_constant(Context* context, int64_t arg,
+                                     uint32_t id);
+        static uint64_t input(Context* context, int64_t arg, uint32_t id);
+        static uint64_t output(Context* context, int64_t arg, uint32_t id);
+        static uint64_t execute(Context* context, int64_t arg, uint32_t id);
+        static uint64_t loop(Context* context, int64_t arg, uint32_t id);
+
+       public:
+        /**
+         * @brief Check if native code can be generated for this platform
+         *
+         * @return bool If it can
+         */
+        static bool supported();
+
+        /**
+         * @brief Compile the bytecode into native code
+         *
+         * @param code The (optimized) bytecode of the program
+         */
+        explicit Jit(const Bytecode& code);
+
+        Jit(const Jit& other) = delete;
+        Jit& operator=(const Jit& other) = delete;
+
+        /**
+         * @brief Destroy the Jit object, unmapping the native code
+         */
+        ~Jit();
+
+        /**
+         * @brief Run the compiled program
+         *
+         * @param glypho_stack The glypho stack the program uses
+         * @param base The base of the numbers that can be read from stdin
+         */
+        void run(Stack* glypho_stack, const int base) const;
+    };
+}    // namespace Glypho::Core
@@ -0,0 +1,395 @@
+/**
+ * @file Loops.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the LoopKernel
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Loops.hpp"
+
+#include <algorithm>
+
+using namespace Glypho::Core;
+
+namespace {
+    /**
+     * @brief Computes base^exponent, checking for overflows
+     *
+     * @param base The base
+     * @param exponent The exponent (positive)
+     * @param result Where the result is stored
+     * @return bool If the computation overflowed
+     */
+    bool pow_overflow(int64_t base, int64_t exponent, int64_t* result) {
+        int64_t power = 1;
+
+        while (exponent > 0) {
+            if ((exponent & 1) && __builtin_mul_overflow(power, base, &power)) {
+                return true;
+            }
+
+            exponent >>= 1;
+            if (exponent > 0 && __builtin_mul_overflow(base, base, &base)) {
+                return true;
+            }
+        }
+
+        *result = power;
+        return false;
+    }
+
+    /**
+     * @brief Checks if a value is not stored inline by the stack
+     *
+     * @param value The value
+     * @return bool If it is too large
+     */
+    bool too_large(const int64_t value) { return !Integer::fits_small(value); }
+
+    /**
+     * @brief Replaces an element of the stack with a small value
+     *
+     * @param glypho_stack The stack
+     * @param depth The depth of the element
+     * @param value The value (it must fit inline)
+     */
+    void store(Stack* glypho_stack, const uint64_t depth, const int64_t value) {
+        Integer::Word& element = glypho_stack->Element(depth);
+        Integer::destroy(element);
+        element = Integer::small_word(value);
+    }
+}    // namespace
+
+LoopKernel::LoopKernel() : valid(false), uses_rotations(false), window(0) {}
+
+LoopKernel::LoopKernel(const Bytecode& code, const LoopInfo& loop,
+                       const uint64_t stack_size)
+    : LoopKernel() {
+    long int end = loop.exit - 1;    // The position of the R-brace
+
+    for (long int pc = loop.body; pc < end; ++pc) {
+        Opcode opcode = code.opcode_at(pc);
+        if (opcode == Opcode::Rot || opcode == Opcode::RRot ||
+            opcode == Opcode::RotN) {
+            uses_rotations = true;
+        }
+    }
+
+    // A rotation moves an element to the bottom of the stack, so the whole
+    // stack must be in the window
+    if (uses_rotations && stack_size > MAX_ROTATION_WINDOW) { return; }
+
+    // The symbolic stack (the top is at the back). The elements that were on
+    // the stack before the loop are added when they are needed.
+    std::vector<uint32_t> elements;
+    uint64_t inputs = 0;
+
+    auto input = [this](uint64_t depth) {
+        return add_node({NodeType::Input, (int64_t)depth, 0, 0});
+    };
+
+    auto need = [&](size_t count) {
+        while (elements.size() < count) {
+            if (uses_rotations || inputs >= stack_size) { return false; }
+            elements.insert(elements.begin(), input(inputs++));
+        }
+        return true;
+    };
+
+    if (uses_rotations) {
+        for (uint64_t depth = stack_size; depth > 0; --depth) {
+            elements.push_back(input(depth - 1));
+        }
+        inputs = stack_size;
+    }
+
+    for (long int pc = loop.body; pc < end; ++pc) {
+        int64_t arg = code.argument_at(pc);
+
+        switch (code.opcode_at(pc)) {
+            case Opcode::NOP: break;
+            case Opcode::Push: {
+                elements.push_back(add_node({NodeType::Const, 1, 0, 0}));
+            } break;
+            case Opcode::PushConst: {
+                elements.push_back(add_node({NodeType::Const, arg, 0, 0}));
+            } break;
+            case Opcode::Dup: {
+                if (!need(1)) { return; }
+                elements.push_back(elements.back());
+            } break;
+            case Opcode::Add:
+            case Opcode::Multiply: {
+                if (!need(2)) { return; }
+                uint32_t right = elements.back();
+                elements.pop_back();
+                uint32_t left = elements.back();
+                NodeType type = (code.opcode_at(pc) == Opcode::Add)
+                                    ? NodeType::Add
+                                    : NodeType::Multiply;
+                elements.back() = add_node({type, 0, left, right});
+            } break;
+            case Opcode::AddConst: {
+                if (!need(1)) { return; }
+                uint32_t constant = add_node({NodeType::Const, arg, 0, 0});
+                elements.back() =
+                    add_node({NodeType::Add, 0, elements.back(), constant});
+            } break;
+            case Opcode::Negate: {
+                if (!need(1)) { return; }
+                elements.back() =
+                    add_node({NodeType::Negate, 0, elements.back(), 0});
+            } break;
+            case Opcode::Swap: {
+                if (!need(2)) { return; }
+                std::swap(elements[elements.size() - 1],
+                          elements[elements.size() - 2]);
+            } break;
+            case Opcode::Pop: {
+                if (!need(1)) { return; }
+                elements.pop_back();
+            } break;
+            case Opcode::Rot:
+            case Opcode::RRot:
+            case Opcode::RotN: {
+                if (elements.empty()) { return; }
+
+                int64_t size = elements.size();
+                int64_t times = (code.opcode_at(pc) == Opcode::RotN) ? arg
+                                : (code.opcode_at(pc) == Opcode::Rot) ? 1
+                                                                      : -1;
+                int64_t steps = ((times % size) + size) % size;
+
+                // Rot moves the top (back) to the bottom (front)
+                std::rotate(elements.begin(), elements.end() - steps,
+                            elements.end());
+            } break;
+            default: return;
+        }
+
+        if (nodes.size() > MAX_NODES) { return; }
+    }
+
+    // The body must leave the stack with the same size, and change the top
+    if (elements.size() != inputs || inputs == 0) { return; }
+
+    window = inputs;
+    for (uint64_t depth = 0; depth < window; ++depth) {
+        uint32_t index = elements[window - 1 - depth];
+        const Node& node = nodes[index];
+
+        if (node.type != NodeType::Input || (uint64_t)node.value != depth) {
+            outputs.push_back({depth, index});
+        }
+    }
+
+    valid = true;
+}
+
+uint32_t LoopKernel::add_node(const Node& node) {
+    const Node& left = nodes.size() > node.left ? nodes[node.left] : node;
+    const Node& right = nodes.size() > node.right ? nodes[node.right] : node;
+    int64_t value;
+
+    // Fold the operations on constants (if they don't overflow)
+    if (node.type == NodeType::Add && left.type == NodeType::Const &&
+        right.type == NodeType::Const &&
+        !__builtin_add_overflow(left.value, right.value, &value)) {
+        return add_node({NodeType::Const, value, 0, 0});
+    }
+    if (node.type == NodeType::Multiply && left.type == NodeType::Const &&
+        right.type == NodeType::Const &&
+        !__builtin_mul_overflow(left.value, right.value, &value)) {
+        return add_node({NodeType::Const, value, 0, 0});
+    }
+    if (node.type == NodeType::Negate && left.type == NodeType::Const &&
+        left.value != INT64_MIN) {
+        return add_node({NodeType::Const, -left.value, 0, 0});
+    }
+
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+bool LoopKernel::is_invariant(const uint32_t index) const {
+    const Node& node = nodes[index];
+
+    switch (node.type) {
+        case NodeType::Const: return true;
+        case NodeType::Input: {
+            for (auto& output : outputs) {
+                if (output.depth == (uint64_t)node.value) { return false; }
+            }
+            return true;
+        }
+        case NodeType::Negate: return is_invariant(node.left);
+        default: return is_invariant(node.left) && is_invariant(node.right);
+    }
+}
+
+void LoopKernel::evaluate(Stack* glypho_stack, std::vector<int64_t>& values,
+                          std::vector<uint8_t>& overflow) const {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& node = nodes[i];
+
+        switch (node.type) {
+            case NodeType::Input: {
+                // The big numbers are left to the interpreter
+                Integer::Word element = glypho_stack->Element(node.value);
+                overflow[i] = !Integer::is_small(element);
+                values[i] = overflow[i] ? 0 : Integer::small_value(element);
+            } break;
+            case NodeType::Const: {
+                // The folded constants can be big numbers too
+                values[i] = node.value;
+                overflow[i] = too_large(node.value);
+            } break;
+            case NodeType::Add: {
+                overflow[i] = overflow[node.left] || overflow[node.right] ||
+                              __builtin_add_overflow(values[node.left],
+                                                     values[node.right],
+                                                     &values[i]) ||
+                              too_large(values[i]);
+            } break;
+            case NodeType::Multiply: {
+                overflow[i] = overflow[node.left] || overflow[node.right] ||
+                              __builtin_mul_overflow(values[node.left],
+                                                     values[node.right],
+                                                     &values[i]) ||
+                              too_large(values[i]);
+            } break;
+            case NodeType::Negate: {
+                overflow[i] =
+                    overflow[node.left] || too_large(-values[node.left]);
+                values[i] = overflow[i] ? 0 : -values[node.left];
+            } break;
+        }
+    }
+}
+
+bool LoopKernel::run_closed_form(Stack* glypho_stack) const {
+    // The counter (the top) must be decremented by 1
+    auto is_input = [this](uint32_t index, uint64_t depth) {
+        return nodes[index].type == NodeType::Input &&
+               (uint64_t)nodes[index].value == depth;
+    };
+    auto is_const = [this](uint32_t index, int64_t value) {
+        return nodes[index].type == NodeType::Const &&
+               nodes[index].value == value;
+    };
+
+    if (outputs.empty() || outputs[0].depth != 0) { return false; }
+    const Node& counter = nodes[outputs[0].node];
+    if (counter.type != NodeType::Add ||
+        !((is_input(counter.left, 0) && is_const(counter.right, -1)) ||
+          (is_const(counter.left, -1) && is_input(counter.right, 0)))) {
+        return false;
+    }
+
+    Integer::Word counter_word = glypho_stack->Element(0);
+    if (!Integer::is_small(counter_word)) { return false; }
+    int64_t iterations = Integer::small_value(counter_word);
+    if (iterations <= 0) { return false; }
+
+    std::vector<int64_t> values(nodes.size());
+    std::vector<uint8_t> overflow(nodes.size());
+    evaluate(glypho_stack, values, overflow);
+
+    // Every other element must be increased or multiplied by an invariant
+    std::vector<int64_t> results(outputs.size(), 0);
+    for (size_t i = 1; i < outputs.size(); ++i) {
+        const Node& node = nodes[outputs[i].node];
+        uint64_t depth = outputs[i].depth;
+        uint32_t step;
+
+        if (node.type != NodeType::Add && node.type != NodeType::Multiply) {
+            return false;
+        }
+
+        if (is_input(node.left, depth)) {
+            step = node.right;
+        } else if (is_input(node.right, depth)) {
+            step = node.left;
+        } else {
+            return false;
+        }
+
+        if (!is_invariant(step) || overflow[step]) { return false; }
+
+        Integer::Word element = glypho_stack->Element(depth);
+        if (!Integer::is_small(element)) { return false; }
+        int64_t value = Integer::small_value(element);
+        int64_t total;
+        if (node.type == NodeType::Add) {
+            if (__builtin_mul_overflow(values[step], iterations, &total) ||
+                __builtin_add_overflow(value, total, &results[i]) ||
+                too_large(results[i])) {
+                return false;
+            }
+        } else {
+            if (pow_overflow(values[step], iterations, &total) ||
+                __builtin_mul_overflow(value, total, &results[i]) ||
+                too_large(results[i])) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < outputs.size(); ++i) {
+        store(glypho_stack, outputs[i].depth, results[i]);
+    }
+    store(glypho_stack, 0, 0);
+
+    return true;
+}
+
+bool LoopKernel::accepts(const uint64_t stack_size) const {
+    return valid &&
+           (uses_rotations ? stack_size == window : stack_size >= window);
+}
+
+bool LoopKernel::run(Stack* glypho_stack) const {
+    if (!valid) { return false; }
+    if (run_closed_form(glypho_stack)) { return true; }
+
+    std::vector<int64_t> values(nodes.size());
+    std::vector<uint8_t> overflow(nodes.size());
+
+    while (true) {
+        evaluate(glypho_stack, values, overflow);
+
+        // Stop before the iteration that overflows
+        for (auto& output : outputs) {
+            if (overflow[output.node]) { return false; }
+        }
+
+        for (auto& output : outputs) {
+            store(glypho_stack, output.depth, values[output.node]);
+        }
+
+        if (glypho_stack->Element(0) == 0) { return true; }
+    }
+}
+
+const LoopKernel& LoopKernels::get(const Bytecode& code, const LoopInfo& loop,
+                                   const uint64_t stack_size) {
+    if (generic.accepts(stack_size)) { return generic; }
+
+    auto cached = by_size.find(stack_size);
+    if (cached != by_size.end()) { return cached->second; }
+
+    LoopKernel kernel(code, loop, stack_size);
+
+    // Kernels without rotations can be used for larger stacks too
+    if (kernel.accepts(stack_size) && kernel.accepts(stack_size + 1)) {
+        generic = kernel;
+        return generic;
+    }
+
+    if (by_size.size() >= MAX_CACHED_SIZES) {
+        scratch = kernel;
+        return scratch;
+    }
+
+    return by_size.emplace(stack_size, kernel).first->second;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file Loops.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the LoopKernel, a native version of a loop that only
+ * changes the stack
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Stack.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the LoopKernel class
+     * The body of the loop is executed symbolically, for a known stack size,
+     * resulting in an expression for each element it changes (the elements
+     * are identified by their depth, 0 being the top). Because the body has a
+     * net-zero stack effect, an iteration is the same as evaluating the
+     * expressions and storing the results, without any dispatch or checks.
+     * If the body decrements the counter (the top) by 1, and every other
+     * element is only increased, or multiplied, by a loop-invariant value,
+     * the whole loop is computed in closed form.
+     */
+    class LoopKernel {
+       private:
+        static const uint64_t MAX_ROTATION_WINDOW = 32;
+        static const uint64_t MAX_NODES = 256;
+
+        enum class NodeType : uint8_t { Input, Const, Add, Multiply, Negate };
+
+        struct Node {
+            NodeType type;
+            int64_t value;    // The constant, or the depth of the input
+            uint32_t left;
+            uint32_t right;
+        };
+
+        struct Output {
+            uint64_t depth;    // The element that is changed
+            uint32_t node;     // Its new value
+        };
+
+        bool valid;                   // If the loop can be run by the kernel
+        bool uses_rotations;          // Rotations depend on the stack size
+        uint64_t window;              // The number of elements it works on
+        std::vector<Node> nodes;      // The expressions, in evaluation order
+        std::vector<Output> outputs;    // The elements that change
+
+        /**
+         * @brief Add a node, folding the constant expressions
+         *
+         * @param node The node
+         * @return uint32_t The index of the node
+         */
+        uint32_t add_node(const Node& node);
+
+        /**
+         * @brief Check if a node only depends on the elements that the loop
+         * does not change
+         *
+         * @param index The node
+         * @return bool If it is loop-invariant
+         */
+        bool is_invariant(const uint32_t index) const;
+
+        /**
+         * @brief Evaluate all the nodes, using the current stack
+         *
+         * @param glypho_stack The stack
+         * @param values Where the values are stored
+         * @param overflow For each node, if it (or a node it depends on)
+         * overflowed, or is not a small Integer
+         */
+        void evaluate(Stack* glypho_stack, std::vector<int64_t>& values,
+                      std::vector<uint8_t>& overflow) const;
+
+        /**
+         * @brief Try to run the whole loop in closed form
+         *
+         * @param glypho_stack The stack
+         * @return bool If the loop was computed
+         */
+        bool run_closed_form(Stack* glypho_stack) const;
+
+       public:
+        /**
+         * @brief Construct a new LoopKernel object
+         * Empty constructor, the kernel is not valid
+         */
+        LoopKernel();
+
+        /**
+         * @brief Compile the body of a loop, for the specified stack size
+         *
+         * @param code The bytecode containing the loop
+         * @param loop The loop
+         * @param stack_size The stack size when the loop is entered
+         */
+        LoopKernel(const Bytecode& code, const LoopInfo& loop,
+                   const uint64_t stack_size);
+
+        /**
+         * @brief Check if the kernel can be used for a stack size
+         *
+         * @param stack_size The stack size
+         * @return bool If it can
+         */
+        bool accepts(const uint64_t stack_size) const;
+
+        /**
+         * @brief Run the loop, starting with an iteration (the top of the stack
+         * was already checked). Stops before an iteration that overflows.
+         *
+         * @param glypho_stack The stack
+         * @return bool True if the loop ended, false if the remaining
+         * iterations must be interpreted
+         */
+        bool run(Stack* glypho_stack) const;
+    };
+
+    /**
+     * @brief The kernels compiled for a loop. Kernels without rotations work
+     * for any stack size that is large enough, the others are compiled for
+     * each stack size.
+     */
+    class LoopKernels {
+       private:
+        static const uint64_t MAX_CACHED_SIZES = 1024;
+
+        LoopKernel generic;
+        std::unordered_map<uint64_t, LoopKernel> by_size;
+        LoopKernel scratch;    // Used when too many sizes are cached
+
+       public:
+        /**
+         * @brief Get the kernel for a stack size, compiling it if needed
+         *
+         * @param code The bytecode containing the loop
+         * @param loop The loop
+         * @param stack_size The stack size
+         * @return const LoopKernel& The kernel (it may not be valid)
+         */
+        const LoopKernel& get(const Bytecode& code, const LoopInfo& loop,
+                              const uint64_t stack_size);
+    };
+}    // namespace Glypho::Core
@@ -0,0 +1,464 @@
+/**
+ * @file Optimizer.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Optimizer passes
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Optimizer.hpp"
+
+#include <algorithm>
+
+using namespace Glypho::Core;
+
+namespace {
+    /**
+     * @brief A constant pushed by a folded sequence
+     */
+    struct Constant {
+        int64_t value;
+        uint32_t source;
+    };
+
+    /**
+     * @brief Checks if the opcode jumps (its argument is a position)
+     *
+     * @param opcode The opcode
+     * @return bool If it jumps
+     */
+    bool is_jump(const Opcode opcode) {
+        return opcode == Opcode::LBrace || opcode == Opcode::RBrace ||
+               opcode == Opcode::DupLBrace;
+    }
+
+    /**
+     * @brief Decode the operation an execute generates from the constants
+     * at the top of the stack (executes that generate other executes use
+     * the next 4 constants, and so on)
+     *
+     * @param constants The constants, the last one is the top of the stack
+     * @param generated Where the operation is stored (a brace is an error)
+     * @param used Where the number of constants it pops is stored
+     * @return bool If there are enough constants
+     */
+    bool decode_constants(const std::vector<Constant>& constants,
+                          InstructionType* generated, size_t* used) {
+        *generated = InstructionType::Execute;
+        *used = 0;
+
+        while (*generated == InstructionType::Execute) {
+            if (constants.size() < *used + 4) { return false; }
+
+            // The values are popped, so the top is the first one
+            Integer values[4];
+            for (size_t i = 0; i < 4; ++i) {
+                values[i] = constants[constants.size() - 1 - *used - i].value;
+            }
+            *used += 4;
+            *generated = decode_number_array(values);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief How an opcode uses the stack
+     */
+    struct StackEffect {
+        int64_t required;    // The size the checks need (0 - no checks)
+        int64_t change;      // How the size changes, if the checks pass
+    };
+
+    /**
+     * @brief Get the stack effect of an opcode. The executes can do almost
+     * anything, so they are handled separately.
+     *
+     * @param opcode The opcode
+     * @return StackEffect The effect
+     */
+    StackEffect stack_effect(const Opcode opcode) {
+        switch (opcode) {
+            case Opcode::Input:
+            case Opcode::Push:
+            case Opcode::PushConst: return {0, 1};
+            case Opcode::Dup:
+            case Opcode::DupLBrace: return {1, 1};
+            case Opcode::Rot:
+            case Opcode::RRot:
+            case Opcode::RotN:
+            case Opcode::Negate:
+            case Opcode::AddConst:
+            case Opcode::LBrace:
+            case Opcode::RBrace:
+            case Opcode::Loop: return {1, 0};
+            case Opcode::Swap: return {2, 0};
+            case Opcode::Add:
+            case Opcode::Multiply: return {2, -1};
+            case Opcode::Output:
+            case Opcode::Pop: return {1, -1};
+            case Opcode::Execute: return {4, -4};
+            default: return {0, 0};
+        }
+    }
+
+    // After this many decreases, the depth of an opcode is set to 0, so the
+    // loops that shrink the stack don't need an iteration for every element
+    const int WIDEN_AFTER = 4;
+
+    // The most opcodes run by the partial evaluation, so the programs that
+    // compute for a long time before their first I/O still load quickly
+    const long int PREFIX_STEPS = 1 << 20;
+}    // namespace
+
+Bytecode Optimizer::peephole(const Bytecode& input) {
+    Bytecode output;
+    long int size = input.size();
+
+    // The position of each input opcode in the output. It is only used for
+    // the jump targets (the opcodes after braces), where nothing is pending.
+    std::vector<int64_t> new_pc(size + 1, 0);
+
+    // The sequences that are not yet written. At most one of add, rotation
+    // and dup is pending, and they are always before the constants.
+    std::vector<Constant> constants;
+    bool add_pending = false;
+    Constant add = {0, 0};
+    long int rotations = 0;
+    Constant rotation = {0, 0};
+    Opcode rotation_opcode = Opcode::Rot;
+    bool dup_pending = false;
+    uint32_t dup_source = 0;
+
+    auto flush = [&]() {
+        if (add_pending) {
+            output.append(Opcode::AddConst, add.value, add.source);
+            add_pending = false;
+        }
+        if (rotations == 1) {
+            output.append(rotation_opcode, 0, rotation.source);
+        } else if (rotations > 1) {
+            output.append(Opcode::RotN, rotation.value, rotation.source);
+        }
+        rotations = 0;
+        if (dup_pending) {
+            output.append(Opcode::Dup, 0, dup_source);
+            dup_pending = false;
+        }
+        for (auto& constant : constants) {
+            output.append(Opcode::PushConst, constant.value, constant.source);
+        }
+        constants.clear();
+    };
+
+    for (long int pc = 0; pc < size; ++pc) {
+        new_pc[pc] = output.size();
+
+        Opcode opcode = input.opcode_at(pc);
+        uint32_t source = input.source_at(pc);
+        bool folded = false;
+
+        // An execute of known constants is replaced by the operation it
+        // generates, which reports its errors for the execute
+        InstructionType generated;
+        size_t used;
+        if (opcode == Opcode::Execute &&
+            decode_constants(constants, &generated, &used)) {
+            constants.resize(constants.size() - used);
+            opcode = (Opcode)generated;
+
+            if (generated == InstructionType::LBrace ||
+                generated == InstructionType::RBrace) {
+                flush();
+                output.append(
+                    Opcode::Raise,
+                    (int64_t)Throwable::RuntimeException::INVALID_EXECUTE,
+                    source);
+                continue;
+            }
+        }
+        long int count = constants.size();
+
+        switch (opcode) {
+            case Opcode::NOP: {
+                folded = true;
+            } break;
+            case Opcode::Push: {
+                // The constants are after a pending add, so it can stay
+                if (rotations != 0 || dup_pending) { flush(); }
+                constants.push_back({1, source});
+                folded = true;
+            } break;
+            case Opcode::Dup: {
+                if (count >= 1) {
+                    constants.push_back(constants.back());
+                } else {
+                    flush();
+                    dup_pending = true;
+                    dup_source = source;
+                }
+                folded = true;
+            } break;
+            case Opcode::Negate: {
+                if (count >= 1 && constants.back().value != INT64_MIN) {
+                    constants.back().value = -constants.back().value;
+                    folded = true;
+                }
+            } break;
+            case Opcode::Add: {
+                int64_t sum;
+                if (count >= 2 &&
+                    !__builtin_add_overflow(constants[count - 2].value,
+                                            constants[count - 1].value, &sum)) {
+                    constants.pop_back();
+                    constants.back().value = sum;
+                    folded = true;
+                } else if (count == 1 && !add_pending) {
+                    // The constant is added to an element already on the
+                    // stack, the error is reported for this add
+                    add = {constants.back().value, source};
+                    add_pending = true;
+                    constants.clear();
+                    folded = true;
+                } else if (count == 1 &&
+                           !__builtin_add_overflow(add.value,
+                                                   constants.back().value,
+                                                   &sum)) {
+                    // Merged with the previous add, which already checked
+                    // the stack
+                    add.value = sum;
+                    constants.clear();
+                    folded = true;
+                }
+            } break;
+            case Opcode::Swap: {
+                if (count >= 2) {
+                    std::swap(constants[count - 2], constants[count - 1]);
+                    folded = true;
+                }
+            } break;
+            case Opcode::Pop: {
+                if (count >= 1) {
+                    constants.pop_back();
+                    folded = true;
+                }
+            } break;
+            case Opcode::Multiply: {
+                int64_t product;
+                if (count >= 2 &&
+                    !__builtin_mul_overflow(constants[count - 2].value,
+                                            constants[count - 1].value,
+                                            &product)) {
+                    constants.pop_back();
+                    constants.back().value = product;
+                    folded = true;
+                }
+            } break;
+            case Opcode::Rot:
+            case Opcode::RRot: {
+                if (rotations == 0) {
+                    flush();
+                    rotation = {0, source};
+                    rotation_opcode = opcode;
+                }
+                rotation.value += (opcode == Opcode::Rot) ? 1 : -1;
+                rotations++;
+                folded = true;
+            } break;
+            case Opcode::LBrace: {
+                if (dup_pending) {
+                    dup_pending = false;
+                    output.append(Opcode::DupLBrace, input.argument_at(pc),
+                                  dup_source);
+                    folded = true;
+                }
+            } break;
+            default: break;
+        }
+
+        if (!folded) {
+            flush();
+            output.append(opcode, input.argument_at(pc), source);
+        }
+    }
+
+    flush();
+    new_pc[size] = output.size();
+
+    // Move the jump targets to the new positions
+    for (long int pc = 0; pc < output.size(); ++pc) {
+        if (is_jump(output.opcode_at(pc))) {
+            output.set_argument(pc, new_pc[output.argument_at(pc)]);
+        }
+    }
+
+    return output;
+}
+
+void Optimizer::loops(Bytecode& code) {
+    for (long int pc = 0; pc < code.size(); ++pc) {
+        if (code.opcode_at(pc) != Opcode::LBrace) { continue; }
+
+        LoopInfo loop = {pc + 1, code.argument_at(pc)};
+        bool pure = true;
+
+        // The R-brace is the last opcode before the exit
+        for (long int i = loop.body; i < loop.exit - 1 && pure; ++i) {
+            switch (code.opcode_at(i)) {
+                case Opcode::NOP:
+                case Opcode::Push:
+                case Opcode::PushConst:
+                case Opcode::Dup:
+                case Opcode::Add:
+                case Opcode::AddConst:
+                case Opcode::Multiply:
+                case Opcode::Negate:
+                case Opcode::Swap:
+                case Opcode::Pop:
+                case Opcode::Rot:
+                case Opcode::RRot:
+                case Opcode::RotN: break;
+                default: pure = false;
+            }
+        }
+
+        if (pure) { code.set_opcode(pc, Opcode::Loop, code.add_loop(loop)); }
+    }
+}
+
+void Optimizer::stack_depth(Bytecode& code) {
+    long int size = code.size();
+
+    // The minimum depth before each opcode (-1 if it is not reached)
+    std::vector<int64_t> depth(size + 1, -1);
+    std::vector<int> decreases(size + 1, 0);
+    std::vector<long int> worklist;
+
+    auto reach = [&](const long int pc, const int64_t value) {
+        if (depth[pc] != -1 && depth[pc] <= value) { return; }
+        if (depth[pc] != -1 && ++decreases[pc] > WIDEN_AFTER) {
+            depth[pc] = 0;
+        } else {
+            depth[pc] = value;
+        }
+        worklist.push_back(pc);
+    };
+
+    reach(0, 0);
+    while (!worklist.empty()) {
+        long int pc = worklist.back();
+        worklist.pop_back();
+
+        Opcode opcode = code.opcode_at(pc);
+        if (opcode == Opcode::Halt || opcode == Opcode::Raise) { continue; }
+
+        // If the checks pass, the stack had at least the required size
+        StackEffect effect = stack_effect(opcode);
+        int64_t after = std::max(depth[pc], effect.required) + effect.change;
+
+        // The generated instruction can remove another element (nested
+        // executes even more), so nothing is known after an execute
+        if (opcode == Opcode::Execute) { after = 0; }
+
+        if (opcode == Opcode::Loop) {
+            const LoopInfo& loop = code.loop_at(code.argument_at(pc));
+            reach(loop.body, after);
+            reach(loop.exit, after);
+            continue;
+        }
+
+        reach(pc + 1, after);
+        if (is_jump(opcode)) { reach(code.argument_at(pc), after); }
+    }
+
+    for (long int pc = 0; pc < size; ++pc) {
+        StackEffect effect = stack_effect(code.opcode_at(pc));
+        code.set_safe(pc, code.opcode_at(pc) != Opcode::Execute &&
+                              effect.required > 0 &&
+                              depth[pc] >= effect.required);
+    }
+}
+
+Bytecode Optimizer::optimize(const Bytecode& input, const int level) {
+    if (level <= 0) { return input; }
+
+    Bytecode output = peephole(input);
+    if (level >= 2) { loops(output); }
+    stack_depth(output);
+
+    return output;
+}
+
+void Optimizer::evaluate_prefix(Bytecode& code, Stack* glypho_stack) {
+    long int pc = code.entry_point();
+
+    for (long int step = 0; step < PREFIX_STEPS; ++step) {
+        Opcode opcode = code.opcode_at(pc);
+        int64_t arg = code.argument_at(pc);
+        uint32_t id = code.source_at(pc);
+        long int next = pc + 1;
+
+        // The failing checks are left for the run
+        if ((int64_t)glypho_stack->Size() < stack_effect(opcode).required) {
+            break;
+        }
+
+        switch (opcode) {
+            case Opcode::NOP: break;
+            case Opcode::Push: {
+                glypho_stack->Push();
+            } break;
+            case Opcode::PushConst: {
+                glypho_stack->Input(arg);
+            } break;
+            case Opcode::Rot: {
+                glypho_stack->Rotate(id);
+            } break;
+            case Opcode::RRot: {
+                glypho_stack->ReverseRotate(id);
+            } break;
+            case Opcode::RotN: {
+                glypho_stack->RotateBy(arg, id);
+            } break;
+            case Opcode::Swap: {
+                glypho_stack->Swap(id);
+            } break;
+            case Opcode::Dup: {
+                glypho_stack->Dup(id);
+            } break;
+            case Opcode::Add: {
+                glypho_stack->Add(id);
+            } break;
+            case Opcode::AddConst: {
+                glypho_stack->AddConstant(arg, id);
+            } break;
+            case Opcode::Multiply: {
+                glypho_stack->Multiply(id);
+            } break;
+            case Opcode::Negate: {
+                glypho_stack->Negate(id);
+            } break;
+            case Opcode::Pop: {
+                glypho_stack->Pop(id);
+            } break;
+            case Opcode::LBrace: {
+                if (glypho_stack->TopIsZero(id)) { next = arg; }
+            } break;
+            case Opcode::RBrace: {
+                if (!glypho_stack->TopIsZero(id)) { next = arg; }
+            } break;
+            case Opcode::DupLBrace: {
+                glypho_stack->Dup(id);
+                if (glypho_stack->TopIsZero(id)) { next = arg; }
+            } break;
+            default: {
+                // Input, Output, Execute, Loop and Halt are left for the run
+                code.set_entry_point(pc);
+                return;
+            }
+        }
+
+        pc = next;
+    }
+
+    code.set_entry_point(pc);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file Optimizer.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Optimizer, the passes that rewrite the bytecode of a
+ * program before running it
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include "Bytecode.hpp"
+
+namespace Glypho::Core {
+    class Optimizer {
+       private:
+        /**
+         * @brief Private constructor to disallow instantiation of this class
+         */
+        Optimizer(){};
+
+        /**
+         * @brief Peephole pass. Removes the NOPs and replaces common
+         * sequences with superinstructions:
+         * - runs of Push/Dup/Add/Negate/Multiply/Swap/Pop that only work on
+         * the values they pushed become PushConst (AddConst, if the run adds
+         * its result to the element under it, like "1-+")
+         * - runs of Rot/RRot become a single RotN
+         * - a Dup followed by a L-brace becomes DupLBrace
+         * - an execute of constants becomes the operation it generates, or
+         * a Raise, if it generates a brace
+         * The superinstructions report errors for the same instruction as the
+         * original sequence.
+         *
+         * @param input The bytecode
+         * @return Bytecode The optimized bytecode
+         */
+        static Bytecode peephole(const Bytecode& input);
+
+        /**
+         * @brief Loop pass. Marks the loops whose body only changes the stack
+         * (no I/O, executes or other loops), so the engine can run them with
+         * a LoopKernel.
+         *
+         * @param code The bytecode, changed in place
+         */
+        static void loops(Bytecode& code);
+
+        /**
+         * @brief Stack depth pass. Computes the minimum size the stack is
+         * guaranteed to have before each opcode (an abstract interpretation
+         * of the bytecode, iterated over the loops until nothing changes),
+         * and marks the opcodes whose stack checks can never fail as safe.
+         * The other opcodes keep their checks, and report the same errors.
+         *
+         * @param code The bytecode, changed in place
+         */
+        static void stack_depth(Bytecode& code);
+
+       public:
+        /**
+         * @brief Optimize the bytecode of a program. The output of the program
+         * (including errors) does not change.
+         *
+         * @param input The bytecode
+         * @param level The optimization level (0 - no optimizations)
+         * @return Bytecode The optimized bytecode
+         */
+        static Bytecode optimize(const Bytecode& input, const int level);
+
+        /**
+         * @brief Partial evaluation. Runs the start of the program, that does
+         * not depend on the input, when it is loaded: the opcodes are run
+         * until the first I/O or execute (its result may depend on the
+         * input), the first loop that can be run by a LoopKernel or the
+         * first check that would fail (the error is reported when the
+         * program runs, like it would without the evaluation). The run then
+         * starts from that opcode, with the stack already built.
+         *
+         * @param code The bytecode, its entry point is changed
+         * @param glypho_stack The stack, where the state is stored
+         */
+        static void evaluate_prefix(Bytecode& code, Stack* glypho_stack);
+    };
+}    // namespace Glypho::Core
@@ -0,0 +1,129 @@
+/**
+ * @file Profiler.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Profiler
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Profiler.hpp"
+
+#include "Helpers.hpp"
+
+using namespace Glypho::Core;
+
+namespace {
+    double seconds(const std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double>(duration).count();
+    }
+}    // namespace
+
+Profiler::Profiler(const Program& program, const std::string& path)
+    : program(program),
+      path(path),
+      file(path),
+      hits(program.size(), 0),
+      type_counts(),
+      generated_counts(),
+      executed(0),
+      stack_high_water(0),
+      finished(false) {
+    Helpers::MUST(file.is_open(),
+                  "ArgumentError: Couldn't write the profile '" + path + "'\n");
+}
+
+Profiler::~Profiler() {
+    // The program was stopped by an error
+    finish();
+}
+
+void Profiler::start() { started = Clock::now(); }
+
+void Profiler::finish() {
+    if (finished) { return; }
+    finished = true;
+
+    // The loops that were running when the program stopped
+    Clock::time_point now = Clock::now();
+    for (auto& loop : active) { loops[loop.start].time += now - loop.entered; }
+    active.clear();
+
+    write();
+}
+
+void Profiler::iteration(const Program::Index start) {
+    LoopStats& loop = loops[start];
+    loop.iterations++;
+
+    // The L-brace is also run after every jump back
+    if (active.empty() || active.back().start != start) {
+        loop.entries++;
+        active.push_back({start, Clock::now()});
+    }
+}
+
+void Profiler::leave(const Program::Index start) {
+    // The R-brace is also run when the L-brace skips the loop
+    if (active.empty() || active.back().start != start) { return; }
+
+    loops[start].time += Clock::now() - active.back().entered;
+    active.pop_back();
+}
+
+void Profiler::write() {
+    file << "{\n";
+    file << "  \"time\": " << seconds(Clock::now() - started) << ",\n";
+    file << "  \"instructions\": " << program.size() << ",\n";
+    file << "  \"executed\": " << executed << ",\n";
+    file << "  \"stack_high_water\": " << stack_high_water << ",\n";
+
+    // The executions of each type, and of the ones generated by executes
+    const uint64_t* counts[2] = {type_counts, generated_counts};
+    const char* names[2] = {"opcodes", "generated"};
+
+    for (int i = 0; i < 2; ++i) {
+        file << "  \"" << names[i] << "\": {";
+        for (size_t type = 0; type < TYPE_COUNT; ++type) {
+            file << (type == 0 ? "\n" : ",\n") << "    \""
+                 << instruction_name((InstructionType)type)
+                 << "\": " << counts[i][type];
+        }
+        file << "\n  },\n";
+    }
+
+    // Only the instructions that were run
+    file << "  \"hits\": [";
+    bool first = true;
+    for (Program::Index id = 0; id < program.size(); ++id) {
+        if (hits[id] == 0) { continue; }
+
+        file << (first ? "\n" : ",\n") << "    {\"id\": " << id
+             << ", \"type\": \"" << instruction_name(program.type_at(id))
+             << "\", \"count\": " << hits[id] << "}";
+        first = false;
+    }
+    file << "\n  ],\n";
+
+    // The loops that were entered, in the order of the program
+    std::vector<Program::Index> starts;
+    for (auto& loop : loops) {
+        if (loop.second.entries != 0) { starts.push_back(loop.first); }
+    }
+    std::sort(starts.begin(), starts.end());
+
+    file << "  \"loops\": [";
+    first = true;
+    for (Program::Index start : starts) {
+        const LoopStats& loop = loops[start];
+
+        file << (first ? "\n" : ",\n") << "    {\"start\": " << start
+             << ", \"end\": " << program.jump_at(start)
+             << ", \"entries\": " << loop.entries
+             << ", \"iterations\": " << loop.iterations
+             << ", \"time\": " << seconds(loop.time) << "}";
+        first = false;
+    }
+    file << "\n  ]\n";
+    file << "}\n";
+
+    file.close();
+}
@@ -0,0 +1,154 @@
+/**
+ * @file Profiler.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Profiler, that collects the execution statistics of a
+ * program run with --profile, and writes them as JSON
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Instruction.hpp"
+#include "Program.hpp"
+#include "Stack.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Profiler class
+     * The hooks are called by the instruction engine, that is a template
+     * over its observer: without --profile, it is instantiated with the
+     * NoProfiler, whose hooks are empty, so it has no overhead. A loop is
+     * entered when its L-brace doesn't jump, every pass through the L-brace
+     * is an iteration, and it is left when its R-brace doesn't jump back.
+     * The profile is also written if the program is stopped by an error.
+     */
+    class Profiler {
+       private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct LoopStats {
+            uint64_t entries;       // How many times the loop was started
+            uint64_t iterations;    // How many times the body was run
+            Clock::duration time;
+        };
+
+        struct ActiveLoop {
+            Program::Index start;    // The id of the L-brace
+            Clock::time_point entered;
+        };
+
+        static const size_t TYPE_COUNT = 15;
+
+        const Program& program;
+        std::string path;
+        std::ofstream file;
+
+        std::vector<uint64_t> hits;    // The executions of each instruction
+        uint64_t type_counts[TYPE_COUNT];
+        uint64_t generated_counts[TYPE_COUNT];
+        std::unordered_map<Program::Index, LoopStats> loops;
+        std::vector<ActiveLoop> active;
+        uint64_t executed;
+        uint64_t stack_high_water;
+        Clock::time_point started;
+        bool finished;
+
+        /**
+         * @brief Write the profile into the file
+         */
+        void write();
+
+       public:
+        /**
+         * @brief Construct a new Profiler object. The output file is opened
+         * right away, so the program is stopped (before running) if it can't
+         * be written.
+         *
+         * @param program The program that is profiled
+         * @param path The path of the JSON file
+         */
+        Profiler(const Program& program, const std::string& path);
+
+        Profiler(const Profiler& other) = delete;
+        Profiler& operator=(const Profiler& other) = delete;
+
+        /**
+         * @brief Destroy the Profiler object, writing the profile if the
+         * program was stopped by an error
+         */
+        ~Profiler();
+
+        /**
+         * @brief Start the measurements (and the timer)
+         */
+        void start();
+
+        /**
+         * @brief Stop the measurements and write the profile
+         */
+        void finish();
+
+        /**
+         * @brief Called before an instruction is run
+         *
+         * @param id The id of the instruction
+         * @param type The type of the instruction
+         */
+        void step(const Program::Index id, const InstructionType type) {
+            hits[id]++;
+            type_counts[(size_t)type]++;
+            executed++;
+        }
+
+        /**
+         * @brief Called after an instruction is run
+         *
+         * @param glypho_stack The glypho stack the program uses
+         */
+        void stack(const Stack& glypho_stack) {
+            stack_high_water = std::max(stack_high_water, glypho_stack.Size());
+        }
+
+        /**
+         * @brief Called when an execute generates an operation
+         *
+         * @param type The operation
+         */
+        void generated(const InstructionType type) {
+            generated_counts[(size_t)type]++;
+        }
+
+        /**
+         * @brief Called when an L-brace doesn't jump (the body is run)
+         *
+         * @param start The id of the L-brace
+         */
+        void iteration(const Program::Index start);
+
+        /**
+         * @brief Called when an R-brace doesn't jump back
+         *
+         * @param start The id of the L-brace of the loop
+         */
+        void leave(const Program::Index start);
+    };
+
+    /**
+     * @brief The observer of the instruction engine when the program is not
+     * profiled. The hooks are empty, and are removed by the compiler.
+     */
+    struct NoProfiler {
+        void step(const Program::Index, const InstructionType) {}
+        void stack(const Stack&) {}
+        void generated(const InstructionType) {}
+        void iteration(const Program::Index) {}
+        void leave(const Program::Index) {}
+    };
+}    // namespace Glypho::Core
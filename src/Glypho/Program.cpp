@@ -0,0 +1,160 @@
+/**
+ * @file Program.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Program
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Program.hpp"
+
+#include <algorithm>
+
+#include "Diagnostics.hpp"
+#include "ThreadPool.hpp"
+
+using namespace Glypho::Core;
+
+namespace {
+    // The smallest part of the program that is linked by a thread (in words
+    // of the brace bitmap, of 64 instructions each)
+    const Program::Index MIN_LINK_WORDS = 1 << 10;
+
+    /**
+     * @brief A brace, and its index in the jump table
+     */
+    struct Brace {
+        Program::Index id;
+        Program::Index index;
+    };
+
+    /**
+     * @brief A part of the program that is linked by a thread, and the
+     * braces that are matched outside of it
+     */
+    struct LinkChunk {
+        Program::Index begin;    // The first word of the bitmap
+        Program::Index end;
+        Program::Index first_brace;    // The index of its first brace
+        Program::Index brace_count;
+        std::vector<Brace> opened;    // Not closed in the chunk, in order
+        std::vector<Brace> closed;    // Not opened in the chunk, in order
+    };
+}    // namespace
+
+Program::Program() : brace_rank(1, 0) {}
+
+Program::Program(std::vector<InstructionType>&& types)
+    : types(std::move(types)) {
+    Helpers::MUST(this->types.size() < END,
+                  "ArgumentError: The program is too large\n");
+    link();
+}
+
+void Program::link() {
+    using namespace Throwable;
+
+    Index instruction_count = size();
+    Index word_count = (instruction_count + 63) / 64;
+    brace_bits.assign(word_count, 0);
+    brace_rank.assign(word_count + 1, 0);
+
+    // Split the program into a chunk for each thread (if it is large)
+    ThreadPool& pool = ThreadPool::instance();
+    Index chunk_count =
+        std::min((Index)pool.size(), word_count / MIN_LINK_WORDS + 1);
+    std::vector<LinkChunk> chunks(chunk_count);
+
+    for (Index i = 0; i < chunk_count; ++i) {
+        chunks[i].begin = word_count / chunk_count * i +
+                          std::min(i, word_count % chunk_count);
+        chunks[i].end = word_count / chunk_count * (i + 1) +
+                        std::min(i + 1, word_count % chunk_count);
+    }
+
+    // Mark and count the braces of every chunk
+    pool.run(chunk_count, [&](size_t i) {
+        LinkChunk& chunk = chunks[i];
+        Index braces = 0;
+
+        for (Index word = chunk.begin; word < chunk.end; ++word) {
+            Index first = word * 64;
+            Index last = std::min(first + 64, instruction_count);
+            uint64_t bits = 0;
+
+            for (Index id = first; id < last; ++id) {
+                bool is_brace = types[id] == InstructionType::LBrace ||
+                                types[id] == InstructionType::RBrace;
+                bits |= (uint64_t)is_brace << (id - first);
+            }
+
+            brace_bits[word] = bits;
+            brace_rank[word] = braces;
+            braces += __builtin_popcountll(bits);
+        }
+
+        chunk.brace_count = braces;
+    });
+
+    // The number of braces before each chunk
+    Index brace_count = 0;
+    for (auto& chunk : chunks) {
+        chunk.first_brace = brace_count;
+        brace_count += chunk.brace_count;
+    }
+    brace_rank[word_count] = brace_count;
+    jumps.assign(brace_count, END);
+
+    // Match the braces of every chunk
+    pool.run(chunk_count, [&](size_t i) {
+        LinkChunk& chunk = chunks[i];
+        std::vector<Brace>& braces_stack = chunk.opened;
+        Index index = chunk.first_brace;
+
+        for (Index word = chunk.begin; word < chunk.end; ++word) {
+            brace_rank[word] += chunk.first_brace;
+
+            for (uint64_t bits = brace_bits[word]; bits != 0;
+                 bits &= bits - 1) {
+                Brace brace = {word * 64 + __builtin_ctzll(bits), index++};
+
+                if (types[brace.id] == InstructionType::LBrace) {
+                    braces_stack.push_back(brace);
+                } else if (braces_stack.empty()) {
+                    // The brace is opened in a previous chunk (or not at all)
+                    chunk.closed.push_back(brace);
+                } else {
+                    // Process code block (link the two braces)
+                    jumps[brace.index] = braces_stack.back().id;
+                    jumps[braces_stack.back().index] = brace.id;
+                    braces_stack.pop_back();
+                }
+            }
+        }
+    });
+
+    // Match the braces between the chunks, in order, so the errors are
+    // found at the same instructions as with a single chunk
+    std::vector<Brace> braces_stack;
+
+    for (auto& chunk : chunks) {
+        for (auto& block_end : chunk.closed) {
+            // Check if there are any opened braces
+            Diagnostics::MUST_NOT(braces_stack.empty(),
+                                  SyntaxError::OPENING_BRACE_EXPECTED,
+                                  block_end.id);
+
+            Brace block_start = braces_stack.back();
+            braces_stack.pop_back();
+
+            jumps[block_end.index] = block_start.id;
+            jumps[block_start.index] = block_end.id;
+        }
+
+        braces_stack.insert(braces_stack.end(), chunk.opened.begin(),
+                            chunk.opened.end());
+    }
+
+    // Check that all braces are closed
+    Diagnostics::MUST(braces_stack.empty(),
+                      SyntaxError::CLOSING_BRACE_EXPECTED, instruction_count);
+}
@@ -0,0 +1,119 @@
+/**
+ * @file Program.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Program, the compact form of a loaded (and linked)
+ * Glypho program, shared by the engines and the passes that read it
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Array.hpp"
+#include "Instruction.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Program class
+     * The instructions are stored as a structure of arrays. The id of an
+     * instruction is its index, and the next instruction is always the
+     * following one, so only the types are stored for every instruction
+     * (1 byte each). The braces are marked in a bitmap, with the number of
+     * braces before every 64 instructions, so the rank of a brace (its index
+     * in the side table of jump targets) is found with a single popcount.
+     * The executes don't need any other data: the instructions they generate
+     * are never stored, and report their errors with the id of the execute.
+     * The arrays can also be mapped from a compiled program.
+     */
+    class Program {
+       public:
+        typedef uint32_t Index;
+
+        // The id after the last instruction
+        static constexpr Index END = UINT32_MAX;
+
+       private:
+        Array<InstructionType> types;    // The type of each instruction
+        Array<uint64_t> brace_bits;      // A bit for each instruction
+        Array<Index> brace_rank;         // The braces before each 64 bits
+        Array<Index> jumps;              // The other brace, for each brace
+
+        friend class Glyc;    // Saves and maps the arrays
+
+        /**
+         * @brief Get the index of a brace in the jump table
+         *
+         * @param id The id of the brace
+         * @return Index The number of braces before it
+         */
+        Index brace_index(const Index id) const {
+            uint64_t before = brace_bits[id / 64] & ((1ULL << (id % 64)) - 1);
+            return brace_rank[id / 64] + __builtin_popcountll(before);
+        }
+
+        /**
+         * @brief Mark the braces, check that they match and store their jump
+         * targets. Large programs are split into chunks, linked in parallel;
+         * the braces left open, or closed without being opened, in a chunk
+         * are then matched with the ones of the other chunks, in order, so
+         * the errors are the same as when the program is linked serially.
+         */
+        void link();
+
+       public:
+        /**
+         * @brief Construct a new Program object
+         * Empty constructor, the program has no instructions
+         */
+        Program();
+
+        /**
+         * @brief Construct and link a new Program object. The program is
+         * stopped with a SyntaxError if the braces don't match.
+         *
+         * @param types The decoded instructions
+         */
+        explicit Program(std::vector<InstructionType>&& types);
+
+        /**
+         * @brief Get the number of instructions
+         *
+         * @return Index The size
+         */
+        Index size() const { return types.size(); }
+
+        /**
+         * @brief Get the type of an instruction
+         *
+         * @param id The id of the instruction
+         * @return InstructionType The type
+         */
+        InstructionType type_at(const Index id) const { return types[id]; }
+
+        /**
+         * @brief Get the id of the instruction executed after another one
+         *
+         * @param id The id of the instruction
+         * @return Index The next id (END after the last instruction)
+         */
+        Index next_at(const Index id) const {
+            return id + 1 < size() ? id + 1 : END;
+        }
+
+        /**
+         * @brief Get the id an instruction jumps to. For braces, it is the
+         * id of the other brace, otherwise, it is the next instruction.
+         *
+         * @param id The id of the instruction
+         * @return Index The jump id
+         */
+        Index jump_at(const Index id) const {
+            if (types[id] != InstructionType::LBrace &&
+                types[id] != InstructionType::RBrace) {
+                return next_at(id);
+            }
+            return jumps[brace_index(id)];
+        }
+    };
+}    // namespace Glypho::Core
@@ -0,0 +1,167 @@
+/**
+ * @file Protocol.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the messages of the interpreter server
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Protocol.hpp"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+using namespace Glypho;
+
+namespace {
+    const uint32_t ROUND_CONSTANTS[64] = {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1,
+        0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+        0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786,
+        0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147,
+        0x06CA6351, 0x14292967, 0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+        0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B,
+        0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A,
+        0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+        0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+    inline uint32_t rotate(const uint32_t value, const int count) {
+        return (value >> count) | (value << (32 - count));
+    }
+
+    /**
+     * @brief Process a 64-byte block of the message
+     *
+     * @param state The state of the hash
+     * @param block The block
+     */
+    void compress(uint32_t* state, const unsigned char* block) {
+        uint32_t words[64];
+        for (int i = 0; i < 16; ++i) {
+            words[i] = (uint32_t)block[4 * i] << 24 |
+                       (uint32_t)block[4 * i + 1] << 16 |
+                       (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotate(words[i - 15], 7) ^
+                          rotate(words[i - 15], 18) ^ (words[i - 15] >> 3);
+            uint32_t s1 = rotate(words[i - 2], 17) ^ rotate(words[i - 2], 19) ^
+                          (words[i - 2] >> 10);
+            words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+            uint32_t choice = (e & f) ^ (~e & g);
+            uint32_t first = h + s1 + choice + ROUND_CONSTANTS[i] + words[i];
+            uint32_t s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t second = s0 + majority;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + first;
+            d = c;
+            c = b;
+            b = a;
+            a = first + second;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}    // namespace
+
+Protocol::Digest Protocol::digest(const char* data, const size_t size) {
+    uint32_t state[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                         0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t done = 0;
+    for (; done + 64 <= size; done += 64) { compress(state, bytes + done); }
+
+    // The rest of the message, the 0x80 byte, zeros and the size in bits
+    unsigned char tail[128] = {};
+    size_t rest = size - done;
+    std::memcpy(tail, bytes + done, rest);
+    tail[rest] = 0x80;
+    size_t length = rest + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (uint64_t)size * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[length - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    compress(state, tail);
+    if (length == 128) { compress(state, tail + 64); }
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        digest[4 * i] = state[i] >> 24;
+        digest[4 * i + 1] = state[i] >> 16;
+        digest[4 * i + 2] = state[i] >> 8;
+        digest[4 * i + 3] = state[i];
+    }
+    return digest;
+}
+
+bool Protocol::read_all(const int fd, void* data, const size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = recv(fd, (char*)data + done, size - done, 0);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { return false; }
+        done += count;
+    }
+    return true;
+}
+
+bool Protocol::write_all(const int fd, const void* data, const size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count =
+            send(fd, (const char*)data + done, size - done, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { return false; }
+        done += count;
+    }
+    return true;
+}
+
+bool Protocol::write_frame(const int fd, const Frame type, const void* data,
+                           const uint32_t size) {
+    char header[5];
+    header[0] = (char)type;
+    std::memcpy(header + 1, &size, sizeof(size));
+
+    return write_all(fd, header, sizeof(header)) &&
+           write_all(fd, data, size);
+}
+
+int Protocol::connect(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) { return -1; }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) { return -1; }
+
+    if (::connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file Protocol.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief The messages exchanged by the interpreter server (--serve) and its
+ * clients, over a Unix socket
+ * @copyright Copyright (c) 2020
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Glypho::Protocol {
+    const uint32_t MAGIC = 0x50594C47;    // "GLYP"
+
+    // The largest source code a server accepts
+    const uint64_t MAX_SOURCE_SIZE = 1ULL << 28;
+
+    /**
+     * @brief The SHA-256 digest of a source code
+     */
+    using Digest = std::array<uint8_t, 32>;
+
+    /**
+     * @brief The first message of a client. The server answers with a single
+     * byte: KNOWN if it has the program in its cache, SEND if the client has
+     * to send the source code (size bytes) after it. Requests for programs
+     * larger than MAX_SOURCE_SIZE are refused (the connection is closed).
+     *
+     * After this, the client sends its input as chunks (the size, as an
+     * uint32_t, followed by the data), and an empty chunk at the end. At the
+     * same time, the server sends the output of the program as frames, and
+     * the exit code at the end.
+     */
+    struct Request {
+        uint32_t magic;
+        uint32_t base;    // The base of the input numbers
+        Digest digest;    // The digest of the source code
+        uint64_t size;    // The size of the source code
+    };
+
+    const uint8_t KNOWN = 'K';
+    const uint8_t SEND = 'S';
+
+    /**
+     * @brief The types of the frames sent by the server. A frame is the
+     * type, the size of the data (an uint32_t) and the data.
+     */
+    enum class Frame : uint8_t {
+        Output = 'O',    // Output of the program (stdout)
+        Error = 'E',     // The error message (stderr)
+        Exit = 'X'       // The exit code (an int32_t), the last frame
+    };
+
+    /**
+     * @brief Compute the SHA-256 digest of a source code
+     *
+     * @param data The source code
+     * @param size The size of the source code
+     * @return Digest The digest
+     */
+    Digest digest(const char* data, const size_t size);
+
+    /**
+     * @brief Read exactly size bytes from a socket
+     *
+     * @param fd The socket
+     * @param data Where the bytes are stored
+     * @param size The number of bytes
+     * @return bool If all the bytes were read
+     */
+    bool read_all(const int fd, void* data, const size_t size);
+
+    /**
+     * @brief Write all the bytes to a socket (without SIGPIPE, if the other
+     * side was closed)
+     *
+     * @param fd The socket
+     * @param data The bytes
+     * @param size The number of bytes
+     * @return bool If all the bytes were written
+     */
+    bool write_all(const int fd, const void* data, const size_t size);
+
+    /**
+     * @brief Write a frame
+     *
+     * @param fd The socket
+     * @param type The type of the frame
+     * @param data The data of the frame
+     * @param size The size of the data
+     * @return bool If the frame was written
+     */
+    bool write_frame(const int fd, const Frame type, const void* data,
+                     const uint32_t size);
+
+    /**
+     * @brief Connect to the socket of a server
+     *
+     * @param path The path of the socket
+     * @return int The socket, or -1 if the server can not be reached
+     */
+    int connect(const std::string& path);
+}    // namespace Glypho::Protocol
@@ -0,0 +1,201 @@
+/**
+ * @file Server.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the interpreter server
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Server.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include "IO.hpp"
+
+using namespace Glypho;
+
+Server::Server(const std::string& path, const Engine engine, const int level)
+    : path(path), engine(engine), optimization_level(level), clients(0) {}
+
+size_t Server::DigestHash::operator()(const Protocol::Digest& digest) const {
+    size_t value;
+    std::memcpy(&value, digest.data(), sizeof(value));
+    return value;
+}
+
+std::shared_ptr<const Interpreter> Server::find(
+    const Protocol::Digest& digest) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = index.find(digest);
+    if (found == index.end()) { return nullptr; }
+
+    cache.splice(cache.begin(), cache, found->second);
+    return found->second->interpreter;
+}
+
+void Server::insert(const Entry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Another client could have loaded the same program
+    auto found = index.find(entry.digest);
+    if (found != index.end()) {
+        cache.erase(found->second);
+        index.erase(found);
+    }
+
+    // The removed programs stay alive while they are still running
+    if (cache.size() == CACHE_SIZE) {
+        index.erase(cache.back().digest);
+        cache.pop_back();
+    }
+
+    cache.push_front(entry);
+    index[entry.digest] = cache.begin();
+}
+
+void Server::respond(const int client) {
+    Protocol::Request request;
+    if (!Protocol::read_all(client, &request, sizeof(request)) ||
+        request.magic != Protocol::MAGIC ||
+        request.size > Protocol::MAX_SOURCE_SIZE) {
+        return;
+    }
+
+    std::shared_ptr<const Interpreter> interpreter = find(request.digest);
+    uint8_t answer = interpreter ? Protocol::KNOWN : Protocol::SEND;
+    if (!Protocol::write_all(client, &answer, sizeof(answer))) { return; }
+
+    int exit_code = 0;
+    std::string error;
+
+    // Load the program, if it is not in the cache (it is stored with the
+    // digest of what was received, not the one in the request)
+    if (!interpreter) {
+        std::string source(request.size, '\0');
+        if (!Protocol::read_all(client, &source[0], source.size())) {
+            return;
+        }
+
+        auto loaded = std::make_shared<Interpreter>();
+        loaded->set_engine(engine);
+        loaded->set_optimization_level(optimization_level);
+
+        Status status = loaded->load_source(source.data(), source.size());
+        if (status.ok()) {
+            interpreter = loaded;
+            insert({Protocol::digest(source.data(), source.size()), loaded});
+        } else {
+            exit_code = status.exit_code;
+            error = status.message;
+        }
+    }
+
+    // The input comes in chunks, until an empty one
+    uint32_t remaining = 0;
+    bool ended = false;
+    IO::Source input = [client, &remaining, &ended](char* buffer,
+                                                    size_t size) -> size_t {
+        while (!ended && remaining == 0) {
+            if (!Protocol::read_all(client, &remaining, sizeof(remaining)) ||
+                remaining == 0) {
+                ended = true;
+            }
+        }
+        if (ended) { return 0; }
+
+        size_t count = std::min<size_t>(size, remaining);
+        if (!Protocol::read_all(client, buffer, count)) {
+            ended = true;
+            return 0;
+        }
+        remaining -= count;
+        return count;
+    };
+
+    // The program is stopped if the client is gone
+    IO::Sink output = [client](const char* data, size_t size) {
+        Helpers::MUST(
+            Protocol::write_frame(client, Protocol::Frame::Output, data, size),
+            "Error: The client closed the connection\n");
+    };
+
+    if (interpreter) {
+        try {
+            Helpers::MUST(request.base > 1,
+                          "ArgumentError: Base '" +
+                              std::to_string(request.base) +
+                              "' is not a valid number\n");
+
+            // The rest of the output is sent before the error
+            IO::Redirect redirect(input, output);
+            interpreter->run_shared(request.base);
+            IO::flush();
+        } catch (const Throwable::Failure& failure) {
+            exit_code = failure.exit_code();
+            error = failure.what();
+        }
+    }
+
+    if (!error.empty()) {
+        Protocol::write_frame(client, Protocol::Frame::Error, error.data(),
+                              error.size());
+    }
+    int32_t code = exit_code;
+    Protocol::write_frame(client, Protocol::Frame::Exit, &code, sizeof(code));
+}
+
+void Server::serve(const int client) {
+    try {
+        respond(client);
+    } catch (...) {
+        // The client gets no exit code, and sees the connection closed
+    }
+    close(client);
+
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    --clients;
+    client_left.notify_one();
+}
+
+void Server::run() {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    Helpers::MUST(path.size() < sizeof(address.sun_path),
+                  "ArgumentError: The socket path '" + path +
+                      "' is too long\n");
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    Helpers::MUST(listener >= 0, "Error: Can not create a socket\n");
+
+    // A socket left by a previous server is replaced
+    unlink(path.c_str());
+    Helpers::MUST(bind(listener, (sockaddr*)&address, sizeof(address)) == 0 &&
+                      listen(listener, SOMAXCONN) == 0,
+                  "Error: Can not listen on '" + path + "'\n");
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(clients_mutex);
+            client_left.wait(lock, [this] { return clients < MAX_CLIENTS; });
+        }
+
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) { continue; }
+
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        try {
+            std::thread(&Server::serve, this, client).detach();
+            ++clients;
+        } catch (const std::system_error&) {
+            close(client);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/**
+ * @file Server.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief A resident interpreter, that runs the programs sent by its clients
+ * over a Unix socket (see Protocol.hpp)
+ * @copyright Copyright (c) 2020
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Interpreter.hpp"
+#include "Protocol.hpp"
+
+namespace Glypho {
+    /**
+     * @brief Declaration for the Server class
+     * Every client is served by its own thread. The loaded (linked and
+     * optimized) programs are kept in a cache, keyed by the SHA-256 digest
+     * of their source code, so a program that was already sent is run
+     * without decoding, linking or optimizing it again; the clients can also
+     * send only the digest of a program the server knows. When the cache is full,
+     * the least recently used program is removed. The loaded programs are
+     * shared by the clients that run them at the same time, each one on its
+     * own copy of the stack, with its I/O redirected to its socket. At most
+     * MAX_CLIENTS clients are served at the same time (the others wait to be
+     * accepted), and a program stops when its output can not be sent, so the
+     * clients that disconnect don't keep their threads.
+     */
+    class Server {
+       private:
+        static const size_t CACHE_SIZE = 64;
+        static const size_t MAX_CLIENTS = 64;
+
+        /**
+         * @brief A loaded program, in the cache
+         */
+        struct Entry {
+            Protocol::Digest digest;
+            std::shared_ptr<const Interpreter> interpreter;
+        };
+
+        /**
+         * @brief Hashes the digests in the index (they are already uniformly
+         * distributed)
+         */
+        struct DigestHash {
+            size_t operator()(const Protocol::Digest& digest) const;
+        };
+
+        std::string path;    // The path of the socket
+        Engine engine;
+        int optimization_level;
+
+        std::mutex mutex;    // Protects the cache
+        std::list<Entry> cache;    // The most recently used program first
+        std::unordered_map<Protocol::Digest, std::list<Entry>::iterator,
+                           DigestHash>
+            index;
+
+        std::mutex clients_mutex;    // Protects the number of clients
+        std::condition_variable client_left;
+        size_t clients;    // The number of clients being served
+
+        /**
+         * @brief Find a program in the cache, marking it as recently used
+         *
+         * @param digest The digest of the source code
+         * @return std::shared_ptr<const Interpreter> The program, or null
+         */
+        std::shared_ptr<const Interpreter> find(
+            const Protocol::Digest& digest);
+
+        /**
+         * @brief Add a program to the cache, removing the least recently
+         * used one if it is full
+         *
+         * @param entry The program
+         */
+        void insert(const Entry& entry);
+
+        /**
+         * @brief Answer the request of a client, and run its program
+         *
+         * @param client The socket of the client
+         */
+        void respond(const int client);
+
+        /**
+         * @brief Serve a client, until its program ends. Any error of the
+         * connection only closes it, so a client can not stop the server.
+         *
+         * @param client The socket of the client (closed at the end, when
+         * it is also removed from the clients being served)
+         */
+        void serve(const int client);
+
+       public:
+        /**
+         * @brief Construct a new Server object
+         *
+         * @param path The path of the socket
+         * @param engine The engine the programs are run with
+         * @param level The optimization level
+         */
+        Server(const std::string& path, const Engine engine, const int level);
+
+        /**
+         * @brief Listen on the socket (replacing an old one) and serve the
+         * clients, until the process is stopped
+         */
+        void run();
+    };
+}    // namespace Glypho
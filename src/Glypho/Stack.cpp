@@ -7,165 +7,304 @@
 
 #include "Stack.hpp"
 
-namespace Glypho::Core {
-    Stack::Stack() { data = std::list<long long int>(); }
+#include "Diagnostics.hpp"
 
-    Stack::Stack(const Stack& other) { this->data = other.data; }
+namespace Glypho::Core {
+    using Throwable::RuntimeException;
+
+    Stack::Stack()
+        : buffer(INITIAL_CAPACITY),
+          mask(INITIAL_CAPACITY - 1),
+          head(0),
+          count(0) {}
+
+    Stack::Stack(const Stack& other)
+        : buffer(other.buffer),
+          mask(other.mask),
+          head(other.head),
+          count(other.count) {
+        // The big numbers are not shared
+        for (uint64_t i = 0; i < count; ++i) { at(i) = Integer::copy(at(i)); }
+    }
 
     Stack& Stack::operator=(const Stack& other) {
-        this->data = other.data;
+        if (this != &other) {
+            Stack copy(other);
+            std::swap(this->buffer, copy.buffer);
+            std::swap(this->mask, copy.mask);
+            std::swap(this->head, copy.head);
+            std::swap(this->count, copy.count);
+        }
         return *this;
     }
 
-    void Stack::Push() { data.push_back(1); }
+    Stack::~Stack() {
+        for (uint64_t i = 0; i < count; ++i) { Integer::destroy(at(i)); }
+    }
+
+    Integer::Word& Stack::at(const uint64_t index) {
+        return buffer[(head + index) & mask];
+    }
+
+    const Integer::Word& Stack::at(const uint64_t index) const {
+        return buffer[(head + index) & mask];
+    }
+
+    Integer Stack::take(const uint64_t index) {
+        Integer::Word& word = at(index);
+        Integer value = Integer::adopt(word);
+        word = Integer::small_word(0);
+        return value;
+    }
+
+    void Stack::reserve_one() {
+        if (count == buffer.size()) { grow(); }
+    }
+
+    void Stack::grow() {
+        std::vector<Integer::Word> new_buffer(buffer.size() * 2);
 
+        // Unwrap the elements, so the bottom is at index 0
+        for (uint64_t i = 0; i < count; ++i) { new_buffer[i] = at(i); }
+
+        buffer.swap(new_buffer);
+        mask = buffer.size() - 1;
+        head = 0;
+    }
+
+    uint64_t Stack::Size() const { return count; }
+
+    Integer::Word& Stack::Element(const uint64_t depth) {
+        return at(count - 1 - depth);
+    }
+
+    void Stack::Push() {
+        reserve_one();
+        at(count++) = Integer::small_word(1);
+    }
+
+    template <bool Checked>
     void Stack::Pop(long int id) {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        data.pop_back();
+        Integer::destroy(at(--count));
     }
 
-    long long int Stack::Peek(long int id) const {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
+    template <bool Checked>
+    bool Stack::TopIsZero(long int id) const {
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        return data.back();
+        return at(count - 1) == 0;
     }
 
-    void Stack::Input(const long long int& value) { data.push_back(value); }
+    void Stack::Input(Integer value) {
+        reserve_one();
+        at(count++) = value.release();
+    }
 
-    long long int Stack::Output(long int id) {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
+    template <bool Checked>
+    Integer Stack::Output(long int id) {
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        long long int value = data.back();
-        data.pop_back();
-        return value;
+        return Integer::adopt(at(--count));
     }
 
+    template <bool Checked>
     void Stack::Dup(long int id) {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        long long int value = data.back();
-        data.push_back(value);
+        reserve_one();
+        Integer::Word value = Integer::copy(at(count - 1));
+        at(count++) = value;
     }
 
+    template <bool Checked>
     void Stack::Swap(long int id) {
-        Helpers::MUST(
-            data.size() >= 2,
-            Throwable::message(
-                Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id) +
-                "\n",
-            -2);
-
-        long long int value1 = data.back();
-        data.pop_back();
-        long long int value2 = data.back();
-        data.pop_back();
+        if constexpr (Checked) {
+            Diagnostics::MUST(count >= 2,
+                              RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+        }
 
-        data.push_back(value1);
-        data.push_back(value2);
+        std::swap(at(count - 1), at(count - 2));
     }
 
+    template <bool Checked>
     void Stack::Rotate(long int id) {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        long long int value = data.back();
-        data.pop_back();
-        data.push_front(value);
+        // The top element becomes the one before the bottom. If the buffer
+        // is full, this is the same slot, so only the head moves.
+        Integer::Word value = at(count - 1);
+        head = (head - 1) & mask;
+        at(0) = value;
     }
 
+    template <bool Checked>
     void Stack::ReverseRotate(long int id) {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        long long int value = data.front();
-        data.pop_front();
-        data.push_back(value);
+        // The bottom element becomes the one after the top
+        Integer::Word value = at(0);
+        head = (head + 1) & mask;
+        at(count - 1) = value;
     }
 
+    template <bool Checked>
+    void Stack::RotateBy(const long long int times, long int id) {
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
+
+        // The number of single rotations that actually change the stack
+        uint64_t steps = ((times % (long long int)count) + count) % count;
+
+        if (steps <= count / 2) {
+            for (uint64_t i = 0; i < steps; ++i) {
+                Integer::Word value = at(count - 1);
+                head = (head - 1) & mask;
+                at(0) = value;
+            }
+        } else {
+            for (uint64_t i = steps; i < count; ++i) {
+                Integer::Word value = at(0);
+                head = (head + 1) & mask;
+                at(count - 1) = value;
+            }
+        }
+    }
+
+    template <bool Checked>
     void Stack::Add(long int id) {
-        Helpers::MUST(
-            data.size() >= 2,
-            Throwable::message(
-                Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id) +
-                "\n",
-            -2);
+        if constexpr (Checked) {
+            Diagnostics::MUST(count >= 2,
+                              RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+        }
 
-        long long int value1 = data.back();
-        data.pop_back();
-        long long int value2 = data.back();
-        data.pop_back();
+        // The sum of two small words is the word of the sum
+        Integer::Word right = at(count - 1);
+        Integer::Word& left = at(count - 2);
+        Integer::Word sum;
+        if (GLYPHO_LIKELY(Integer::is_small(left | right) &&
+                          !__builtin_add_overflow((int64_t)left,
+                                                  (int64_t)right,
+                                                  (int64_t*)&sum))) {
+            left = sum;
+        } else {
+            Integer augend = take(count - 2);
+            Integer addend = take(count - 1);
+            left = (augend + addend).release();
+        }
+        count--;
+    }
+
+    template <bool Checked>
+    void Stack::AddConstant(const int64_t value, long int id) {
+        if constexpr (Checked) {
+            Diagnostics::MUST(count >= 1,
+                              RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+        }
 
-        data.push_back(value1 + value2);
+        Integer::Word& top = at(count - 1);
+        Integer::Word sum;
+        if (GLYPHO_LIKELY(Integer::is_small(top) &&
+                          Integer::fits_small(value) &&
+                          !__builtin_add_overflow(
+                              (int64_t)top, (int64_t)Integer::small_word(value),
+                              (int64_t*)&sum))) {
+            top = sum;
+        } else {
+            Integer augend = take(count - 1);
+            top = (augend + Integer(value)).release();
+        }
     }
 
+    template <bool Checked>
     void Stack::Multiply(long int id) {
-        Helpers::MUST(
-            data.size() >= 2,
-            Throwable::message(
-                Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id) +
-                "\n",
-            -2);
-
-        long long int value1 = data.back();
-        data.pop_back();
-        long long int value2 = data.back();
-        data.pop_back();
+        if constexpr (Checked) {
+            Diagnostics::MUST(count >= 2,
+                              RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+        }
 
-        data.push_back(value1 * value2);
+        // Only one of the factors keeps its tag, so the product is a word
+        Integer::Word right = at(count - 1);
+        Integer::Word& left = at(count - 2);
+        Integer::Word product;
+        if (GLYPHO_LIKELY(Integer::is_small(left | right) &&
+                          !__builtin_mul_overflow(Integer::small_value(left),
+                                                  (int64_t)right,
+                                                  (int64_t*)&product))) {
+            left = product;
+        } else {
+            Integer multiplicand = take(count - 2);
+            Integer multiplier = take(count - 1);
+            left = (multiplicand * multiplier).release();
+        }
+        count--;
     }
 
+    template <bool Checked>
     void Stack::Negate(long int id) {
-        Helpers::MUST_NOT(
-            data.size() == 0,
-            Throwable::message(Throwable::RuntimeException::EMPTY_STACK, id) +
-                "\n",
-            -2);
-
-        long long int value = data.back();
-        value = 0 - value;
+        if constexpr (Checked) {
+            Diagnostics::MUST_NOT(count == 0, RuntimeException::EMPTY_STACK,
+                                  id);
+        }
 
-        data.pop_back();
-        data.push_back(value);
+        Integer::Word& value = at(count - 1);
+        Integer::Word negated;
+        if (GLYPHO_LIKELY(Integer::is_small(value) &&
+                          !__builtin_sub_overflow((int64_t)0, (int64_t)value,
+                                                  (int64_t*)&negated))) {
+            value = negated;
+        } else {
+            value = (-take(count - 1)).release();
+        }
     }
 
-    std::vector<long long int> Stack::Out_K_Elems(const uint64_t count,
-                                                  long int id) {
-        Helpers::MUST(
-            data.size() >= count,
-            Throwable::message(
-                Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id) +
-                "\n",
-            -2);
+    void Stack::Out_K_Elems(const uint64_t count, Integer* values,
+                            long int id) {
+        Diagnostics::MUST(this->count >= count,
+                          RuntimeException::INSUFFICIENT_STACK_SIZE, id);
 
-        std::vector<long long int> values;
         for (uint64_t i = 0; i < count; ++i) {
-            values.push_back(data.back());
-            data.pop_back();
+            values[i] = Integer::adopt(at(--this->count));
         }
-
-        return values;
     }
-}    // namespace Glypho::Core
\ No newline at end of file
+
+    // The checked and unchecked variants of the operations that can fail
+#define GLYPHO_STACK_VARIANTS(Checked)                                     \
+    template void Stack::Pop<Checked>(long int);                          \
+    template bool Stack::TopIsZero<Checked>(long int) const;              \
+    template Integer Stack::Output<Checked>(long int);                    \
+    template void Stack::Dup<Checked>(long int);                          \
+    template void Stack::Swap<Checked>(long int);                         \
+    template void Stack::Rotate<Checked>(long int);                       \
+    template void Stack::ReverseRotate<Checked>(long int);                \
+    template void Stack::RotateBy<Checked>(const long long int, long int); \
+    template void Stack::Add<Checked>(long int);                          \
+    template void Stack::AddConstant<Checked>(const int64_t, long int);   \
+    template void Stack::Multiply<Checked>(long int);                     \
+    template void Stack::Negate<Checked>(long int);
+
+    GLYPHO_STACK_VARIANTS(true)
+    GLYPHO_STACK_VARIANTS(false)
+#undef GLYPHO_STACK_VARIANTS
+}    // namespace Glypho::Core
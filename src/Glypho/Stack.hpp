@@ -2,26 +2,90 @@
  * @file Stack.hpp
  * @author Grama Nicolae (gramanicu@gmail.com)
  * @brief Header for that Stack class, the stack used by the glypho interpreter
- * Internally, the top of the stack is the end of the vector and vice-versa
+ * Internally, the stack is a ring buffer: the top of the stack is the end of
+ * the used region and the bottom is its start, so both ends can be accessed
+ * in O(1). The elements are Integer words: the operations on small numbers
+ * are done inline, and the others (or the ones that overflow) use Integer.
  * @copyright Copyright (c) 2020
  */
 #pragma once
 
+#include <cstdint>
 #include <iostream>
-#include <list>
 #include <string>
 #include <vector>
 
 #include "Helpers.hpp"
+#include "Integer.hpp"
 
 namespace Glypho::Core {
+    class Jit;
+    class TopCache;
+
     class Stack {
        private:
-        std::list<long long int> data;
+        // The native code keeps the ring buffer state in registers
+        friend class Jit;
+        // Keeps the top element outside of the buffer
+        friend class TopCache;
+
+        static const uint64_t INITIAL_CAPACITY = 64;
+
+        std::vector<Integer::Word> buffer;    // The ring buffer (the capacity
+                                              // is always a power of 2). The
+                                              // words outside the used region
+                                              // are not owned.
+        uint64_t mask;     // capacity - 1, used to wrap the indexes
+        uint64_t head;     // The index of the bottom element
+        uint64_t count;    // The number of elements in the stack
+
+        /**
+         * @brief Get the element at the specified position, counting from the
+         * bottom of the stack
+         *
+         * @param index The position
+         * @return Integer::Word& The element
+         */
+        Integer::Word& at(const uint64_t index);
+
+        /**
+         * @brief Get the element at the specified position, counting from the
+         * bottom of the stack
+         *
+         * @param index The position
+         * @return const Integer::Word& The element
+         */
+        const Integer::Word& at(const uint64_t index) const;
+
+        /**
+         * @brief Move an element out of the buffer, leaving a small zero in
+         * its place. The operations that can fail take their operands first,
+         * so a number is never owned by both the stack and a temporary.
+         *
+         * @param index The position, counting from the bottom of the stack
+         * @return Integer The element
+         */
+        Integer take(const uint64_t index);
+
+        /**
+         * @brief Make sure there is space for another element, doubling the
+         * capacity if the buffer is full
+         *
+         */
+        void reserve_one();
+
+        /**
+         * @brief Double the capacity of the buffer, moving the elements to the
+         * start of the new one
+         *
+         */
+        void grow();
 
        public:
         // The id that some functions receive is the id of the current
-        // instruction (for error handling)
+        // instruction (for error handling). The operations that can fail
+        // have an unchecked variant (Checked = false), used where the size
+        // of the stack is known to be large enough.
         /**
          * @brief Construct a new Stack object
          *
@@ -43,6 +107,28 @@ namespace Glypho::Core {
          */
         Stack& operator=(const Stack& other);
 
+        /**
+         * @brief Destroy the Stack object, freeing the big numbers
+         *
+         */
+        ~Stack();
+
+        /**
+         * @brief Get the number of elements in the stack
+         *
+         * @return uint64_t The size
+         */
+        uint64_t Size() const;
+
+        /**
+         * @brief Direct access to an element, used by the engines that work
+         * on multiple elements at once. The caller must check the size.
+         *
+         * @param depth The position, counting from the top (0 is the top)
+         * @return Integer::Word& The element
+         */
+        Integer::Word& Element(const uint64_t depth);
+
         // Basic Stack Operations
         /**
          * @brief Add an element at the top of the stack with the value of 1
@@ -53,16 +139,18 @@ namespace Glypho::Core {
         /**
          * @brief Take the element from the top of the stack
          *
-         * @return Integer
          */
+        template <bool Checked = true>
         void Pop(long int id);
 
         /**
-         * @brief Get the element from the top of the stack, but don't remove it
+         * @brief Check if the element from the top of the stack is 0, without
+         * removing it
          *
-         * @return Integer The value
+         * @return bool If it is 0
          */
-        long long int Peek(long int id) const;
+        template <bool Checked = true>
+        bool TopIsZero(long int id) const;
 
         /**
          * @brief Add an element at the top of the stack with the specified
@@ -70,50 +158,76 @@ namespace Glypho::Core {
          *
          * @param value New value
          */
-        void Input(const long long int& value);
+        void Input(Integer value);
 
         /**
          * @brief Get the element at the top of the stack and remove it
          *
          * @return Integer The top value
          */
-        long long int Output(long int id);
+        template <bool Checked = true>
+        Integer Output(long int id);
 
         // Complex Stack Operations
         /**
          * @brief Duplicate the element at the top of the stack
          *
          */
+        template <bool Checked = true>
         void Dup(long int id);
 
         /**
          * @brief Swaps the top 2 elements in the stack
          *
          */
+        template <bool Checked = true>
         void Swap(long int id);
 
         /**
          * @brief Put the top element at the back
          *
          */
+        template <bool Checked = true>
         void Rotate(long int id);
 
         /**
          * @brief Put the back element at the top
          *
          */
+        template <bool Checked = true>
         void ReverseRotate(long int id);
 
+        /**
+         * @brief Rotates the stack multiple times. Is the same as calling
+         * Rotate (or ReverseRotate, for negative values) that many times, but
+         * takes the shortest way around the ring buffer
+         *
+         * @param times The number of rotations
+         */
+        template <bool Checked = true>
+        void RotateBy(const long long int times, long int id);
+
         /**
          * @brief Takes the top two elements, computes their sum, and pushes the
          * new element Will remove the two elements
          */
+        template <bool Checked = true>
         void Add(long int id);
 
+        /**
+         * @brief Adds a constant to the top element. Fails in the same way as
+         * pushing the constant and calling Add
+         *
+         * @param value The constant
+         */
+        template <bool Checked = true>
+        void AddConstant(const int64_t value, long int id);
+
         /**
          * @brief Takes the top two elements, computes their product, and pushes
          * the new element Will remove the two elements
          */
+        template <bool Checked = true>
         void Multiply(long int id);
 
         /**
@@ -121,16 +235,15 @@ namespace Glypho::Core {
          * value
          *
          */
+        template <bool Checked = true>
         void Negate(long int id);
 
         /**
-         * @brief Removes and retuns the specified amount of elements from the
-         * stack
+         * @brief Removes the specified amount of elements from the stack
          *
          * @param count The number of elements
-         * @return std::vector<long long int> An array of elements
+         * @param values The array where the elements are stored, top first
          */
-        std::vector<long long int> Out_K_Elems(const uint64_t count,
-                                               long int id);
+        void Out_K_Elems(const uint64_t count, Integer* values, long int id);
     };
 }    // namespace Glypho::Core
\ No newline at end of file
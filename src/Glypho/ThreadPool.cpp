@@ -0,0 +1,96 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the ThreadPool
+ * @copyright Copyright (c) 2020
+ */
+
+#include "ThreadPool.hpp"
+
+using namespace Glypho::Core;
+
+namespace {
+    // If the current thread is running a task
+    thread_local bool in_task = false;
+}    // namespace
+
+ThreadPool::ThreadPool()
+    : task(nullptr), count(0), next(0), done(0), stopping(false) {}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) { worker.join(); }
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::size() const {
+    unsigned int threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+void ThreadPool::work(std::unique_lock<std::mutex>& lock) {
+    while (next < count) {
+        size_t index = next++;
+
+        lock.unlock();
+        in_task = true;
+        (*task)(index);
+        in_task = false;
+        lock.lock();
+
+        if (++done == count) { finished.notify_all(); }
+    }
+}
+
+void ThreadPool::worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || next < count; });
+        if (stopping) { return; }
+
+        work(lock);
+    }
+}
+
+void ThreadPool::run(const size_t count,
+                     const std::function<void(size_t)>& task) {
+    // Small jobs (and the ones started by tasks) are run directly, by the
+    // caller
+    if (count <= 1 || size() == 1 || in_task) {
+        for (size_t i = 0; i < count; ++i) { task(i); }
+        return;
+    }
+
+    std::lock_guard<std::mutex> job(busy);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (workers.empty()) {
+        for (size_t i = 1; i < size(); ++i) {
+            workers.push_back(std::thread(&ThreadPool::worker, this));
+        }
+    }
+
+    this->task = &task;
+    this->count = count;
+    next = 0;
+    done = 0;
+    wake.notify_all();
+
+    work(lock);
+    finished.wait(lock, [this]() { return done == this->count; });
+
+    // No task is left, so the workers keep waiting
+    this->task = nullptr;
+    this->count = 0;
+    next = 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file ThreadPool.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the ThreadPool, the persistent workers used to load large
+ * programs in parallel
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the ThreadPool class
+     * There is a single pool, with a worker for each hardware thread (except
+     * the one of the caller, that also works). The workers are started the
+     * first time they are needed, and then wait for the next job, so loading
+     * a program doesn't create any threads. A job is a parallel loop over
+     * the indices of its tasks, and it only returns when all of them are
+     * done. The tasks are handed out one at a time, so the threads that
+     * finish early take the remaining ones. A task can start its own job,
+     * which is run by the thread of the task. The tasks must not raise
+     * errors (nothing would catch them), so they only store their results,
+     * that are checked after the job.
+     */
+    class ThreadPool {
+       private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;         // Protects the current job
+        std::mutex busy;          // Allows a single job at a time
+        std::condition_variable wake;        // A job was started
+        std::condition_variable finished;    // All the tasks are done
+        const std::function<void(size_t)>* task;
+        size_t count;    // The number of tasks of the job
+        size_t next;     // The next task that is not started
+        size_t done;     // The number of finished tasks
+        bool stopping;
+
+        ThreadPool();
+        ~ThreadPool();
+
+        /**
+         * @brief Run the tasks of the current job, until none are left
+         *
+         * @param lock The lock of the mutex (must be locked)
+         */
+        void work(std::unique_lock<std::mutex>& lock);
+
+        /**
+         * @brief The loop of a worker, that waits for the jobs
+         */
+        void worker();
+
+       public:
+        ThreadPool(const ThreadPool& other) = delete;
+        ThreadPool& operator=(const ThreadPool& other) = delete;
+
+        /**
+         * @brief Get the pool
+         *
+         * @return ThreadPool& The pool
+         */
+        static ThreadPool& instance();
+
+        /**
+         * @brief Get the number of threads that run a job (with the caller)
+         *
+         * @return size_t The number of threads
+         */
+        size_t size() const;
+
+        /**
+         * @brief Run task(0), task(1), ..., task(count - 1) in parallel, and
+         * wait for them to finish
+         *
+         * @param count The number of tasks
+         * @param task The task
+         */
+        void run(const size_t count, const std::function<void(size_t)>& task);
+    };
+}    // namespace Glypho::Core
@@ -0,0 +1,391 @@
+/**
+ * @file TopCache.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the TopCache, that keeps the top of the stack in a local
+ * variable while the bytecode runs
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "Diagnostics.hpp"
+#include "Integer.hpp"
+#include "Stack.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the TopCache class
+     * The bytecode engine is a template over the way it accesses the stack.
+     * With --engine=cached, the top element is kept in a local variable (so
+     * in a register, across the dispatch), and the ring buffer holds the
+     * elements below it. The operations on the top (the braces, pushes,
+     * pops, I/O and arithmetic) are done inline, on the variable and on the
+     * element below it. The top is spilled into the buffer before the
+     * operations that use the whole stack (rotations, executes and the loop
+     * kernels), and loaded back after them. The checks raise the same errors
+     * as the ones of the Stack. The top is also spilled when the cache is
+     * destroyed, so the stack is complete after the run (or after an error).
+     */
+    class TopCache {
+       private:
+        Stack* stack;          // The elements below the top
+        Integer::Word top;     // The top element
+        bool cached;           // If there is a top (the stack is not empty)
+
+        /**
+         * @brief Get an element of the buffer, counting from the bottom
+         *
+         * @param index The position
+         * @return Integer::Word& The element
+         */
+        Integer::Word& slot(const uint64_t index) {
+            return stack->buffer[(stack->head + index) & stack->mask];
+        }
+
+        /**
+         * @brief Move the top into the buffer, to make room for a new one
+         */
+        void push_top() {
+            if (stack->count == stack->buffer.size()) { stack->grow(); }
+            slot(stack->count++) = top;
+        }
+
+        /**
+         * @brief Take the next top from the buffer, after the top was removed
+         */
+        void pop_top() {
+            cached = stack->count > 0;
+            if (cached) { top = slot(--stack->count); }
+        }
+
+        /**
+         * @brief Move the top out of the cache, before an operation that can
+         * fail (the result is cached again only if it succeeds, so the number
+         * is never owned by both the cache and a temporary)
+         *
+         * @return Integer The top element
+         */
+        Integer take_top() {
+            Integer value = Integer::adopt(top);
+            top = 0;
+            cached = false;
+            return value;
+        }
+
+        /**
+         * @brief Set the top to the result of an operation on the old one
+         *
+         * @param value The result
+         */
+        void set_top(Integer value) {
+            top = value.release();
+            cached = true;
+        }
+
+        /**
+         * @brief Add a new top element
+         *
+         * @param value The element
+         */
+        void push_word(const Integer::Word value) {
+            if (cached) { push_top(); }
+            top = value;
+            cached = true;
+        }
+
+       public:
+        /**
+         * @brief Construct a new TopCache object, loading the top of a stack
+         *
+         * @param stack The stack
+         */
+        explicit TopCache(Stack* stack) : stack(stack), top(0), cached(false) {
+            pop_top();
+        }
+
+        TopCache(const TopCache& other) = delete;
+        TopCache& operator=(const TopCache& other) = delete;
+
+        /**
+         * @brief Destroy the TopCache object, putting the top back
+         */
+        ~TopCache() { spill(); }
+
+        /**
+         * @brief Put the top back into the stack, before an operation that
+         * uses the whole stack (the cache is empty until load is called)
+         *
+         * @return Stack* The complete stack
+         */
+        Stack* spill() {
+            if (cached) { push_top(); }
+            cached = false;
+            return stack;
+        }
+
+        /**
+         * @brief Load the top of the stack again, after spill
+         */
+        void load() { pop_top(); }
+
+        void Push() { push_word(Integer::small_word(1)); }
+
+        void Input(Integer value) { push_word(value.release()); }
+
+        /**
+         * @brief Add a constant element (the argument of a PushConst)
+         *
+         * @param value The value
+         */
+        void PushConstant(const int64_t value) {
+            if (GLYPHO_LIKELY(Integer::fits_small(value))) {
+                push_word(Integer::small_word(value));
+            } else {
+                Input(Integer(value));
+            }
+        }
+
+        template <bool Checked = true>
+        void Pop(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    cached, Throwable::RuntimeException::EMPTY_STACK, id);
+            }
+
+            if (!Integer::is_small(top)) { Integer::destroy(top); }
+            pop_top();
+        }
+
+        template <bool Checked = true>
+        bool TopIsZero(long int id) const {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    cached, Throwable::RuntimeException::EMPTY_STACK, id);
+            }
+
+            return top == 0;
+        }
+
+        template <bool Checked = true>
+        Integer Output(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    cached, Throwable::RuntimeException::EMPTY_STACK, id);
+            }
+
+            Integer value = Integer::adopt(top);
+            pop_top();
+            return value;
+        }
+
+        template <bool Checked = true>
+        void Dup(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    cached, Throwable::RuntimeException::EMPTY_STACK, id);
+            }
+
+            Integer::Word value =
+                Integer::is_small(top) ? top : Integer::copy(top);
+            push_top();
+            top = value;
+        }
+
+        // Without a top, the buffer is empty, so its size is enough for the
+        // checks of the operations on two elements
+        template <bool Checked = true>
+        void Swap(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    stack->count >= 1,
+                    Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+            }
+
+            std::swap(top, slot(stack->count - 1));
+        }
+
+        template <bool Checked = true>
+        void Rotate(long int id) {
+            spill()->Rotate<Checked>(id);
+            load();
+        }
+
+        template <bool Checked = true>
+        void ReverseRotate(long int id) {
+            spill()->ReverseRotate<Checked>(id);
+            load();
+        }
+
+        template <bool Checked = true>
+        void RotateBy(const long long int times, long int id) {
+            spill()->RotateBy<Checked>(times, id);
+            load();
+        }
+
+        template <bool Checked = true>
+        void Add(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    stack->count >= 1,
+                    Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+            }
+
+            Integer::Word left = slot(--stack->count);
+            Integer::Word sum;
+            if (GLYPHO_LIKELY(Integer::is_small(left | top) &&
+                              !__builtin_add_overflow((int64_t)left,
+                                                      (int64_t)top,
+                                                      (int64_t*)&sum))) {
+                top = sum;
+            } else {
+                Integer augend = Integer::adopt(left);
+                Integer addend = take_top();
+                set_top(augend + addend);
+            }
+        }
+
+        template <bool Checked = true>
+        void AddConstant(const int64_t value, long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    cached,
+                    Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+            }
+
+            Integer::Word sum;
+            if (GLYPHO_LIKELY(Integer::is_small(top) &&
+                              Integer::fits_small(value) &&
+                              !__builtin_add_overflow(
+                                  (int64_t)top,
+                                  (int64_t)Integer::small_word(value),
+                                  (int64_t*)&sum))) {
+                top = sum;
+            } else {
+                Integer augend = take_top();
+                set_top(augend + Integer(value));
+            }
+        }
+
+        template <bool Checked = true>
+        void Multiply(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    stack->count >= 1,
+                    Throwable::RuntimeException::INSUFFICIENT_STACK_SIZE, id);
+            }
+
+            // Only one of the factors keeps its tag, so the product is a word
+            Integer::Word left = slot(--stack->count);
+            Integer::Word product;
+            if (GLYPHO_LIKELY(
+                    Integer::is_small(left | top) &&
+                    !__builtin_mul_overflow(Integer::small_value(left),
+                                            (int64_t)top,
+                                            (int64_t*)&product))) {
+                top = product;
+            } else {
+                Integer multiplicand = Integer::adopt(left);
+                Integer multiplier = take_top();
+                set_top(multiplicand * multiplier);
+            }
+        }
+
+        template <bool Checked = true>
+        void Negate(long int id) {
+            if constexpr (Checked) {
+                Diagnostics::MUST(
+                    cached, Throwable::RuntimeException::EMPTY_STACK, id);
+            }
+
+            Integer::Word negated;
+            if (GLYPHO_LIKELY(Integer::is_small(top) &&
+                              !__builtin_sub_overflow((int64_t)0, (int64_t)top,
+                                                      (int64_t*)&negated))) {
+                top = negated;
+            } else {
+                set_top(-take_top());
+            }
+        }
+    };
+
+    /**
+     * @brief The stack access of the bytecode engine without the cache: the
+     * operations are the ones of the Stack, and the stack is always complete
+     */
+    class NoCache {
+       private:
+        Stack* stack;
+
+       public:
+        explicit NoCache(Stack* stack) : stack(stack) {}
+
+        Stack* spill() { return stack; }
+        void load() {}
+
+        void Push() { stack->Push(); }
+        void Input(Integer value) { stack->Input(std::move(value)); }
+        void PushConstant(const int64_t value) { stack->Input(value); }
+
+        template <bool Checked = true>
+        void Pop(long int id) {
+            stack->Pop<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        bool TopIsZero(long int id) const {
+            return stack->TopIsZero<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        Integer Output(long int id) {
+            return stack->Output<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void Dup(long int id) {
+            stack->Dup<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void Swap(long int id) {
+            stack->Swap<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void Rotate(long int id) {
+            stack->Rotate<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void ReverseRotate(long int id) {
+            stack->ReverseRotate<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void RotateBy(const long long int times, long int id) {
+            stack->RotateBy<Checked>(times, id);
+        }
+
+        template <bool Checked = true>
+        void Add(long int id) {
+            stack->Add<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void AddConstant(const int64_t value, long int id) {
+            stack->AddConstant<Checked>(value, id);
+        }
+
+        template <bool Checked = true>
+        void Multiply(long int id) {
+            stack->Multiply<Checked>(id);
+        }
+
+        template <bool Checked = true>
+        void Negate(long int id) {
+            stack->Negate<Checked>(id);
+        }
+    };
+}    // namespace Glypho::Core
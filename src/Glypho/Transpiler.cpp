@@ -0,0 +1,123 @@
+/**
+ * @file Transpiler.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Definitions for the Transpiler
+ * @copyright Copyright (c) 2020
+ */
+
+#include "Transpiler.hpp"
+
+using namespace Glypho::Core;
+
+namespace {
+    /**
+     * @brief The start of every generated file, the function that runs the
+     * program
+     */
+    const char* const PRELUDE = R"glypho(
+#include <string>
+
+#include "Glypho/Diagnostics.hpp"
+#include "Glypho/Helpers.hpp"
+#include "Glypho/Instruction.hpp"
+#include "Glypho/Stack.hpp"
+
+using namespace Glypho;
+
+// The program, reading the numbers in the specified base
+void run(const int base) {
+    Core::Stack stack;
+)glypho";
+
+    /**
+     * @brief The end of every generated file, the main function that reads
+     * the base and reports the errors
+     */
+    const char* const EPILOGUE = R"glypho(}
+
+int main(int argc, char** argv) {
+    int base = Constants::DEFAULT_INPUT_BASE;
+
+    try {
+        // The base is the only (optional) argument
+        Helpers::MUST(argc <= 2,
+                      "ArgumentError: Invalid number of arguments\n");
+        if (argc == 2) {
+            try {
+                base = std::stoi(argv[1]);
+            } catch (std::exception& e) {
+                Helpers::MUST(false, "ArgumentError: Base '" +
+                                         std::string(argv[1]) +
+                                         "' is not a number\n");
+            }
+            Helpers::MUST(base > 1, "ArgumentError: Base '" +
+                                        std::to_string(base) +
+                                        "' is not a valid number\n");
+        }
+
+        run(base);
+    } catch (const Throwable::Failure& failure) {
+        // The errors stop the program, after its output is written
+        return Diagnostics::report(failure);
+    }
+
+    return 0;
+}
+)glypho";
+}    // namespace
+
+std::string Transpiler::statement(const InstructionType type,
+                                  const long int instruction_id) {
+    std::string id = std::to_string(instruction_id);
+
+    switch (type) {
+        case InstructionType::Input:
+            return "stack.Input(Helpers::readNumber(base, " + id + "));";
+        case InstructionType::Rot: return "stack.Rotate(" + id + ");";
+        case InstructionType::Swap: return "stack.Swap(" + id + ");";
+        case InstructionType::Push: return "stack.Push();";
+        case InstructionType::RRot: return "stack.ReverseRotate(" + id + ");";
+        case InstructionType::Dup: return "stack.Dup(" + id + ");";
+        case InstructionType::Add: return "stack.Add(" + id + ");";
+        case InstructionType::Output:
+            return "Helpers::printNumber(base, stack.Output(" + id + "));";
+        case InstructionType::Multiply: return "stack.Multiply(" + id + ");";
+        case InstructionType::Execute:
+            return "Core::execute_generated(&stack, " + id + ", base);";
+        case InstructionType::Negate: return "stack.Negate(" + id + ");";
+        case InstructionType::Pop: return "stack.Pop(" + id + ");";
+        default: return "";
+    }
+}
+
+std::string Transpiler::transpile(const Program& program,
+                                  const std::string& path) {
+    std::string source = "// Generated by glypho2cpp from " + path + "\n";
+    source += PRELUDE;
+
+    std::string indent(4, ' ');
+
+    for (Program::Index id = 0; id < program.size(); ++id) {
+        InstructionType type = program.type_at(id);
+
+        switch (type) {
+            case InstructionType::NOP: break;
+            case InstructionType::LBrace: {
+                // Errors of both braces are reported for the L-brace
+                source += indent + "while (!stack.TopIsZero(" +
+                          std::to_string(id) + ")) {\n";
+                indent += "    ";
+            } break;
+            case InstructionType::RBrace: {
+                indent.resize(indent.size() - 4);
+                source += indent + "}\n";
+            } break;
+            default: {
+                source += indent + statement(type, id) + "\n";
+            } break;
+        }
+    }
+
+    source += EPILOGUE;
+    return source;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file Transpiler.hpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Declares the Transpiler, that translates a Glypho program into a
+ * C++ source file
+ * @copyright Copyright (c) 2020
+ */
+#pragma once
+
+#include <string>
+
+#include "Instruction.hpp"
+#include "Program.hpp"
+
+namespace Glypho::Core {
+    /**
+     * @brief Declaration for the Transpiler class
+     * Every instruction becomes a call on the Stack (so the numbers are
+     * Integers, like in the interpreter), and the braces become while loops
+     * (the check of the R-brace is the same as the one of its L-brace, so it
+     * is done at the start of the loop). The generated code is compiled
+     * together with the runtime sources, so the I/O, the errors and the
+     * executes behave exactly like in the interpreter.
+     */
+    class Transpiler {
+       private:
+        /**
+         * @brief Private constructor to disallow instantiation of this class
+         */
+        Transpiler(){};
+
+        /**
+         * @brief Get the statement that runs an instruction (braces excluded)
+         *
+         * @param type The type of the instruction
+         * @param id The id of the instruction
+         * @return std::string The statement
+         */
+        static std::string statement(const InstructionType type,
+                                     const long int id);
+
+       public:
+        /**
+         * @brief Translate a program into C++
+         *
+         * @param program The program, after linking
+         * @param path The path of the program, mentioned in the output
+         * @return std::string The C++ source code
+         */
+        static std::string transpile(const Program& program,
+                                     const std::string& path);
+    };
+}    // namespace Glypho::Core
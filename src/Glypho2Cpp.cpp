@@ -0,0 +1,61 @@
+/**
+ * @file Glypho2Cpp.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Driver code for the Glypho to C++ transpiler
+ * @copyright Copyright (c) 2020
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "./Glypho/Diagnostics.hpp"
+#include "./Glypho/Helpers.hpp"
+#include "./Glypho/Interpreter.hpp"
+#include "./Glypho/Transpiler.hpp"
+
+namespace {
+    /**
+     * @brief Transpile the program in the arguments
+     *
+     * @param argc The number of arguments
+     * @param argv The arguments
+     */
+    void run(int argc, char** argv) {
+        // Check the program arguments (the program, and the optional output)
+        if (argc != 2 && argc != 3) {
+            Glypho::Helpers::MUST(
+                false, "ArgumentError: Invalid number of arguments\n");
+        }
+
+        // Load the program, using the interpreter (the same syntax checks)
+        std::string path(argv[1]);
+        Glypho::Interpreter g_interpreter(path);
+        g_interpreter.set_engine(Glypho::Engine::Reference);
+        g_interpreter.load_program();
+
+        std::string source = Glypho::Core::Transpiler::transpile(
+            g_interpreter.get_program(), path);
+
+        // Write the C++ code to the output file, or to stdout
+        if (argc == 2) {
+            std::cout << source;
+        } else {
+            std::ofstream output(argv[2]);
+            Glypho::Helpers::MUST(output.good(),
+                                  "ArgumentError: Can not write '" +
+                                      std::string(argv[2]) + "'\n");
+            output << source;
+        }
+    }
+}    // namespace
+
+int main(int argc, char** argv) {
+    try {
+        run(argc, argv);
+    } catch (const Glypho::Throwable::Failure& failure) {
+        return Glypho::Diagnostics::report(failure);
+    }
+
+    return 0;
+}
@@ -0,0 +1,547 @@
+/**
+ * @file GlyphoBench.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief Driver code for the benchmarks. The big programs of the checker and
+ * some generated workloads are run with the interpreter, and the results are
+ * printed as JSON, so they can be compared between versions.
+ * @copyright Copyright (c) 2020
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./Glypho/Diagnostics.hpp"
+#include "./Glypho/Helpers.hpp"
+#include "./Glypho/Interpreter.hpp"
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // The symbols of the simplified code, like in checker/glypher.py (the
+    // index of a symbol, in base 3, is the pattern of its instruction)
+    const std::string SYMBOLS = "ni?>\\1?\?\?<d+[o*e-!]";
+
+    // The instructions in each block of a huge source file
+    const size_t HUGE_BLOCK = 1 << 12;
+
+    /**
+     * @brief A program that is benchmarked, with its input
+     */
+    struct Workload {
+        std::string name;
+        std::string program;    // The path of the .gly file
+        std::string input;      // The path of the input file
+        std::string base;       // The base argument (empty for the default)
+    };
+
+    /**
+     * @brief The results of a workload (the times are the medians)
+     */
+    struct Result {
+        uint64_t source_bytes;
+        uint64_t instructions;    // The size of the program
+        uint64_t executed;        // The instructions that were run
+        int exit_code;
+        double load;        // The time to load the program (in process)
+        double wall;        // The time of a complete run
+        double wall_min;    // The fastest run
+        long peak_rss;      // In KB
+        uint64_t output_bytes;
+    };
+
+    /**
+     * @brief The options of the benchmarks
+     */
+    struct Options {
+        std::string interpreter;    // The path of the interpreter
+        std::vector<std::string> engine_options;    // Passed to it
+        Glypho::Engine engine;
+        int optimization_level;
+        int runs;
+        uint64_t scale;    // Multiplies the size of the generated workloads
+        std::string only;    // Run only the workloads with this prefix
+    };
+
+    double median(std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    /**
+     * @brief Encode simplified code (a symbol for each instruction) into
+     * Glypho code. The characters of every instruction are picked by a
+     * seeded generator, so the same file is generated every time.
+     *
+     * @param simplified The simplified code
+     * @param generator The random generator
+     * @return std::string The Glypho code
+     */
+    std::string encode(const std::string& simplified,
+                       std::mt19937* generator) {
+        std::string alphabet;
+        for (char character = 33; character < 127; ++character) {
+            alphabet += character;
+        }
+
+        std::string code;
+        for (char symbol : simplified) {
+            size_t index = SYMBOLS.find(symbol);
+            if (index == std::string::npos || symbol == '?') { continue; }
+
+            // The digits of the index, in base 3 (the last one is special)
+            int digits[4] = {0, 1, 2, 3};
+            if (index != 18) {
+                for (int i = 3; i >= 0; --i) {
+                    digits[i] = index % 3;
+                    index /= 3;
+                }
+            }
+
+            std::shuffle(alphabet.begin(), alphabet.end(), *generator);
+            for (int digit : digits) { code += alphabet[digit]; }
+        }
+
+        return code;
+    }
+
+    void write_file(const std::string& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+        Glypho::Helpers::MUST(file.good(), "ArgumentError: Can not write '" +
+                                               path + "'\n");
+    }
+
+    uint64_t file_size(const std::string& path) {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+    }
+
+    /**
+     * @brief Generate a workload from simplified code
+     *
+     * @param directory Where the files are created
+     * @param name The name of the workload
+     * @param simplified The simplified code
+     * @param input The input of the program
+     * @return Workload The workload
+     */
+    Workload generate(const std::string& directory, const std::string& name,
+                      const std::string& simplified,
+                      const std::string& input) {
+        std::mt19937 generator(2020);
+        Workload workload = {name, directory + "/" + name + ".gly",
+                             directory + "/" + name + ".in", ""};
+
+        write_file(workload.program, encode(simplified, &generator));
+        write_file(workload.input, input);
+        return workload;
+    }
+
+    /**
+     * @brief Generate a huge program (pushes and pops), to measure the
+     * loading. The same block of code is written many times.
+     *
+     * @param directory Where the files are created
+     * @param instructions The number of instructions (rounded to blocks)
+     * @return Workload The workload
+     */
+    Workload generate_huge(const std::string& directory,
+                           const uint64_t instructions) {
+        std::mt19937 generator(2020);
+        Workload workload = {"huge-source", directory + "/huge-source.gly",
+                             directory + "/huge-source.in", ""};
+
+        std::string simplified;
+        for (size_t i = 0; i < HUGE_BLOCK / 2; ++i) { simplified += "1!"; }
+        std::string block = encode(simplified, &generator) + "\n";
+
+        std::ofstream file(workload.program, std::ios::binary);
+        for (uint64_t i = 0; i < instructions / HUGE_BLOCK; ++i) {
+            file << block;
+        }
+        file.close();
+
+        write_file(workload.input, "");
+        return workload;
+    }
+
+    /**
+     * @brief Get the big programs of the checker (with their inputs and
+     * bases), sorted by name
+     *
+     * @return std::vector<Workload> The workloads
+     */
+    std::vector<Workload> checker_workloads() {
+        const std::string directory = "checker/tests";
+        std::vector<Workload> workloads;
+
+        DIR* listing = opendir(directory.c_str());
+        if (listing == nullptr) { return workloads; }
+
+        while (struct dirent* entry = readdir(listing)) {
+            std::string file(entry->d_name);
+            if (file.rfind("big", 0) != 0 || file.size() < 4 ||
+                file.compare(file.size() - 4, 4, ".gly") != 0) {
+                continue;
+            }
+
+            std::string name = file.substr(0, file.size() - 4);
+            workloads.push_back({name, directory + "/" + file,
+                                 directory + "/" + name + ".in", ""});
+        }
+        closedir(listing);
+
+        // The bonus tests use other bases (found by prefix, like test.sh)
+        std::ifstream config("checker/base.cfg");
+        std::string name, base;
+        while (config >> name >> base) {
+            for (auto& workload : workloads) {
+                if (name.rfind(workload.name, 0) == 0) { workload.base = base; }
+            }
+        }
+
+        std::sort(workloads.begin(), workloads.end(),
+                  [](const Workload& left, const Workload& right) {
+                      return left.name < right.name;
+                  });
+        return workloads;
+    }
+
+    /**
+     * @brief Run the interpreter on a workload, as a child process
+     *
+     * @param options The options of the benchmarks
+     * @param workload The workload
+     * @param extra An extra option for the interpreter (if not empty)
+     * @param output Where the output is written
+     * @param peak_rss Where the peak RSS of the child is stored (in KB)
+     * @return int The exit code (-1 if the child was killed)
+     */
+    int spawn(const Options& options, const Workload& workload,
+              const std::string& extra, const std::string& output,
+              long* peak_rss) {
+        std::vector<std::string> arguments = {options.interpreter};
+        arguments.insert(arguments.end(), options.engine_options.begin(),
+                         options.engine_options.end());
+        if (!extra.empty()) { arguments.push_back(extra); }
+        arguments.push_back(workload.program);
+        if (!workload.base.empty()) { arguments.push_back(workload.base); }
+
+        pid_t child = fork();
+        Glypho::Helpers::MUST(child >= 0, "Error: Can not start a process\n");
+
+        if (child == 0) {
+            int input = open(workload.input.c_str(), O_RDONLY);
+            int result = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                              0644);
+            int null = open("/dev/null", O_WRONLY);
+            if (input < 0 || result < 0 || null < 0) { _exit(127); }
+
+            dup2(input, STDIN_FILENO);
+            dup2(result, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+
+            std::vector<char*> argv;
+            for (auto& argument : arguments) {
+                argv.push_back(const_cast<char*>(argument.c_str()));
+            }
+            argv.push_back(nullptr);
+
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+
+        int status;
+        struct rusage usage;
+        while (wait4(child, &status, 0, &usage) < 0) {}
+
+        *peak_rss = usage.ru_maxrss;
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    /**
+     * @brief Get the number of executed instructions, from a profile
+     *
+     * @param path The path of the profile
+     * @return uint64_t The number of instructions
+     */
+    uint64_t read_executed(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+
+        // The count is at the start (the profile can be large)
+        while (std::getline(file, line)) {
+            size_t position = line.find("\"executed\": ");
+            if (position != std::string::npos) {
+                return std::strtoull(line.c_str() + position + 12, nullptr, 10);
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief Measure the loading of a program, in process, without running
+     * it. This is done in a child process, so the memory used by the loaded
+     * programs isn't counted in the peak RSS of the next runs (a child starts
+     * with the pages of its parent).
+     *
+     * @param options The options of the benchmarks
+     * @param workload The workload
+     * @param instructions Where the size of the program is stored
+     * @return double The median time
+     */
+    double measure_load(const Options& options, const Workload& workload,
+                        uint64_t* instructions) {
+        double results[2] = {0, 0};
+        int channel[2];
+        Glypho::Helpers::MUST(pipe(channel) == 0,
+                              "Error: Can not create a pipe\n");
+
+        pid_t child = fork();
+        Glypho::Helpers::MUST(child >= 0, "Error: Can not start a process\n");
+
+        if (child == 0) {
+            std::vector<double> loads;
+            for (int run = 0; run < options.runs; ++run) {
+                Glypho::Interpreter interpreter(workload.program);
+                interpreter.set_engine(options.engine);
+                interpreter.set_optimization_level(options.optimization_level);
+
+                // The child doesn't return to main, on errors
+                Clock::time_point start = Clock::now();
+                try {
+                    interpreter.load_program();
+                } catch (const Glypho::Throwable::Failure& failure) {
+                    _exit(Glypho::Diagnostics::report(failure));
+                }
+                loads.push_back(std::chrono::duration<double>(Clock::now() -
+                                                              start)
+                                    .count());
+
+                results[1] = interpreter.get_program().size();
+            }
+            results[0] = median(loads);
+
+            ssize_t written = write(channel[1], results, sizeof(results));
+            _exit(written == sizeof(results) ? 0 : 1);
+        }
+
+        close(channel[1]);
+        ssize_t count = read(channel[0], results, sizeof(results));
+        close(channel[0]);
+        waitpid(child, nullptr, 0);
+
+        // The program has a syntax error
+        if (count != sizeof(results)) { return 0; }
+
+        *instructions = results[1];
+        return results[0];
+    }
+
+    /**
+     * @brief Measure a workload
+     *
+     * @param options The options of the benchmarks
+     * @param workload The workload
+     * @param directory Where the temporary files are created
+     * @return Result The results
+     */
+    Result measure(const Options& options, const Workload& workload,
+                   const std::string& directory) {
+        Result result = {};
+        result.source_bytes = file_size(workload.program);
+        std::string output = directory + "/output";
+
+        result.load = measure_load(options, workload, &result.instructions);
+
+        // The number of executed instructions doesn't depend on the engine,
+        // so it is taken from a single profiled run
+        std::string profile = directory + "/profile.json";
+        long ignored;
+        spawn(options, workload, "--profile=" + profile, output, &ignored);
+        result.executed = read_executed(profile);
+
+        std::vector<double> walls;
+        std::vector<double> peaks;
+        for (int run = 0; run < options.runs; ++run) {
+            long peak_rss;
+
+            Clock::time_point start = Clock::now();
+            result.exit_code = spawn(options, workload, "", output, &peak_rss);
+            walls.push_back(
+                std::chrono::duration<double>(Clock::now() - start).count());
+            peaks.push_back(peak_rss);
+        }
+        result.wall = median(walls);
+        result.wall_min = *std::min_element(walls.begin(), walls.end());
+        result.peak_rss = median(peaks);
+        result.output_bytes = file_size(output);
+
+        unlink(output.c_str());
+        unlink(profile.c_str());
+        return result;
+    }
+
+    /**
+     * @brief Write the results of a workload as a JSON object
+     *
+     * @param os The stream
+     * @param name The name of the workload
+     * @param result The results
+     */
+    void write_result(std::ostream& os, const std::string& name,
+                      const Result& result) {
+        double wall = std::max(result.wall, 1e-9);
+
+        os << "    {\"name\": \"" << name << "\""
+           << ", \"source_bytes\": " << result.source_bytes
+           << ", \"instructions\": " << result.instructions
+           << ", \"executed\": " << result.executed
+           << ", \"exit_code\": " << result.exit_code
+           << ", \"load_seconds\": " << result.load
+           << ", \"wall_seconds\": " << result.wall
+           << ", \"wall_seconds_min\": " << result.wall_min
+           << ", \"instructions_per_second\": " << result.executed / wall
+           << ", \"peak_rss_kb\": " << result.peak_rss
+           << ", \"output_bytes\": " << result.output_bytes
+           << ", \"output_bytes_per_second\": " << result.output_bytes / wall
+           << "}";
+    }
+
+    /**
+     * @brief Run the benchmarks selected by the arguments
+     *
+     * @param argc The number of arguments
+     * @param argv The arguments
+     */
+    void run(int argc, char** argv) {
+        Options options = {"./GlyphoIntepreter",
+                           {},
+                           Glypho::Engine::Bytecode,
+                           Glypho::Constants::DEFAULT_OPTIMIZATION_LEVEL,
+                           5,
+                           1,
+                           ""};
+
+        // The engine options are also passed to the interpreter
+        for (int i = 1; i < argc; ++i) {
+            std::string argument(argv[i]);
+
+            if (argument.rfind("--interpreter=", 0) == 0) {
+                options.interpreter = argument.substr(14);
+            } else if (argument.rfind("--runs=", 0) == 0) {
+                options.runs = std::max(1, std::atoi(argument.c_str() + 7));
+            } else if (argument.rfind("--scale=", 0) == 0) {
+                options.scale = std::max(1, std::atoi(argument.c_str() + 8));
+            } else if (argument.rfind("--only=", 0) == 0) {
+                options.only = argument.substr(7);
+            } else if (argument.size() == 3 && argument.rfind("-O", 0) == 0 &&
+                       isdigit(argument[2])) {
+                options.optimization_level = argument[2] - '0';
+                options.engine_options.push_back(argument);
+            } else if (argument == "--engine=reference") {
+                options.engine = Glypho::Engine::Reference;
+                options.engine_options.push_back(argument);
+            } else if (argument == "--engine=bytecode") {
+                options.engine = Glypho::Engine::Bytecode;
+                options.engine_options.push_back(argument);
+            } else if (argument == "--engine=cached") {
+                options.engine = Glypho::Engine::Cached;
+                options.engine_options.push_back(argument);
+            } else if (argument == "--jit" || argument == "--engine=jit") {
+                options.engine = Glypho::Engine::Jit;
+                options.engine_options.push_back(argument);
+            } else {
+                Glypho::Helpers::MUST(false, "ArgumentError: Unknown option '" +
+                                                 argument + "'\n");
+            }
+        }
+
+        Glypho::Helpers::MUST(access(options.interpreter.c_str(), X_OK) == 0,
+                              "ArgumentError: Can not run '" +
+                                  options.interpreter + "'\n");
+
+        char directory_template[] = "/tmp/glypho-bench-XXXXXX";
+        Glypho::Helpers::MUST(mkdtemp(directory_template) != nullptr,
+                              "Error: Can not create a temporary directory\n");
+        std::string directory(directory_template);
+
+        // The generated workloads, then the big programs of the checker
+        uint64_t scale = options.scale;
+        std::vector<Workload> workloads = {
+            generate(directory, "deep-rotation", "i[d1-+]!i[><1-+]",
+                     "10000 " + std::to_string(2000000 * scale)),
+            generate(directory, "execute-heavy", "i[dddde1-+]",
+                     std::to_string(1000000 * scale)),
+            generate(directory, "counted-loop", "i[dd*!1-+]",
+                     std::to_string(10000000 * scale)),
+            generate(directory, "nested-loop", "i[1[1-+]!1-+]",
+                     std::to_string(1000000 * scale)),
+            generate(directory, "output", "i[do1-+]",
+                     std::to_string(1000000 * scale)),
+            generate_huge(directory, 8000000 * scale)};
+
+        std::vector<Workload> checker = checker_workloads();
+        workloads.insert(workloads.end(), checker.begin(), checker.end());
+
+        // The results are written to stdout, the progress to stderr
+        std::ostream& os = std::cout;
+        os << "{\n";
+        os << "  \"interpreter\": \"" << options.interpreter << "\",\n";
+        os << "  \"options\": \"";
+        for (size_t i = 0; i < options.engine_options.size(); ++i) {
+            os << (i == 0 ? "" : " ") << options.engine_options[i];
+        }
+        os << "\",\n";
+        os << "  \"runs\": " << options.runs << ",\n";
+        os << "  \"scale\": " << options.scale << ",\n";
+        os << "  \"workloads\": [";
+
+        bool first = true;
+        for (auto& workload : workloads) {
+            if (workload.name.rfind(options.only, 0) != 0) { continue; }
+
+            std::cerr << workload.name << "... " << std::flush;
+            Result result = measure(options, workload, directory);
+            std::cerr << result.wall << " s\n";
+
+            os << (first ? "\n" : ",\n");
+            write_result(os, workload.name, result);
+            first = false;
+        }
+        os << "\n  ]\n}\n";
+
+        // Remove the generated files
+        for (auto& workload : workloads) {
+            if (workload.program.rfind(directory, 0) == 0) {
+                unlink(workload.program.c_str());
+                unlink(workload.input.c_str());
+            }
+        }
+        rmdir(directory.c_str());
+    }
+}    // namespace
+
+int main(int argc, char** argv) {
+    try {
+        run(argc, argv);
+    } catch (const Glypho::Throwable::Failure& failure) {
+        return Glypho::Diagnostics::report(failure);
+    }
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file GlyphoClient.cpp
+ * @author Grama Nicolae (gramanicu@gmail.com)
+ * @brief A client for the interpreter server (--serve). It takes the same
+ * arguments as the interpreter (after the socket), sends the program and its
+ * input to the server, and prints the output, the errors and exits with the
+ * exit code of the program.
+ * @copyright Copyright (c) 2020
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./Glypho/Helpers.hpp"
+#include "./Glypho/Protocol.hpp"
+
+namespace {
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    /**
+     * @brief Write all the bytes to a file descriptor
+     *
+     * @param fd The file descriptor
+     * @param data The bytes
+     * @param size The number of bytes
+     */
+    void write_file(const int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t count = write(fd, data, size);
+            if (count < 0 && errno == EINTR) { continue; }
+            if (count <= 0) { return; }
+            data += count;
+            size -= count;
+        }
+    }
+
+    /**
+     * @brief Read a whole file
+     *
+     * @param path The path of the file
+     * @param contents Where the contents are stored
+     * @return bool If the file could be read
+     */
+    bool read_file(const std::string& path, std::string* contents) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) { return false; }
+
+        std::vector<char> block(BLOCK_SIZE);
+        ssize_t count;
+        while ((count = read(fd, block.data(), block.size())) != 0) {
+            if (count < 0 && errno == EINTR) { continue; }
+            if (count < 0) { break; }
+            contents->append(block.data(), count);
+        }
+        close(fd);
+        return count == 0;
+    }
+
+    /**
+     * @brief Send stdin to the server, in chunks, ending with an empty one
+     *
+     * @param server The socket of the server
+     */
+    void send_input(const int server) {
+        std::vector<char> block(BLOCK_SIZE);
+        while (true) {
+            ssize_t count = read(STDIN_FILENO, block.data(), block.size());
+            if (count < 0 && errno == EINTR) { continue; }
+
+            uint32_t size = count > 0 ? count : 0;
+            if (!Glypho::Protocol::write_all(server, &size, sizeof(size)) ||
+                size == 0 ||
+                !Glypho::Protocol::write_all(server, block.data(), size)) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Run a program on the server
+     *
+     * @param argc The number of arguments
+     * @param argv The arguments
+     * @return int The exit code of the program
+     */
+    int run(int argc, char** argv) {
+        using namespace Glypho;
+
+        // The socket, the program and the optional base
+        Helpers::MUST(argc == 3 || argc == 4,
+                      "ArgumentError: Invalid number of arguments\n");
+
+        // The base is checked like the interpreter does
+        int base = Constants::DEFAULT_INPUT_BASE;
+        if (argc == 4) {
+            try {
+                base = std::stoi(argv[3]);
+            } catch (std::exception& e) {
+                Helpers::MUST(false, "ArgumentError: Base '" +
+                                         std::string(argv[3]) +
+                                         "' is not a number\n");
+            }
+            Helpers::MUST(base > 1, "ArgumentError: Base '" +
+                                        std::to_string(base) +
+                                        "' is not a valid number\n");
+        }
+
+        std::string source;
+        Helpers::MUST(
+            read_file(argv[2], &source),
+            "ArgumentError: Couldn't find or open the specified file\n");
+        Helpers::MUST(source.size() <= Protocol::MAX_SOURCE_SIZE,
+                      "Error: The program is too large for the server\n");
+
+        int server = Protocol::connect(argv[1]);
+        Helpers::MUST(server >= 0, "Error: Can not connect to '" +
+                                       std::string(argv[1]) + "'\n");
+
+        // Only the digest is used, if the server already has the program
+        Protocol::Request request = {
+            Protocol::MAGIC, (uint32_t)base,
+            Protocol::digest(source.data(), source.size()), source.size()};
+        uint8_t answer = 0;
+        bool sent = Protocol::write_all(server, &request, sizeof(request)) &&
+                    Protocol::read_all(server, &answer, sizeof(answer));
+        if (sent && answer == Protocol::SEND) {
+            sent = Protocol::write_all(server, source.data(), source.size());
+        }
+        Helpers::MUST(sent, "Error: The server closed the connection\n");
+
+        // The input is sent while the output is received (the thread stops
+        // with the process, if the program doesn't read all of it)
+        std::thread(send_input, server).detach();
+
+        std::vector<char> data;
+        while (true) {
+            char header[5];
+            uint32_t size;
+            Helpers::MUST(Protocol::read_all(server, header, sizeof(header)),
+                          "Error: The server closed the connection\n");
+            std::memcpy(&size, header + 1, sizeof(size));
+
+            data.resize(size);
+            Helpers::MUST(Protocol::read_all(server, data.data(), size),
+                          "Error: The server closed the connection\n");
+
+            switch ((Protocol::Frame)header[0]) {
+                case Protocol::Frame::Output: {
+                    write_file(STDOUT_FILENO, data.data(), size);
+                } break;
+                case Protocol::Frame::Error: {
+                    write_file(STDERR_FILENO, data.data(), size);
+                } break;
+                case Protocol::Frame::Exit: {
+                    int32_t code = 0;
+                    std::memcpy(&code, data.data(),
+                                std::min<size_t>(size, sizeof(code)));
+                    return code;
+                }
+            }
+        }
+    }
+}    // namespace
+
+int main(int argc, char** argv) {
+    try {
+        return run(argc, argv);
+    } catch (const Glypho::Throwable::Failure& failure) {
+        std::cerr << failure.what();
+        return failure.exit_code();
+    }
+}
@@ -7,51 +7,191 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include "./Glypho/Batch.hpp"
+#include "./Glypho/Diagnostics.hpp"
 #include "./Glypho/Helpers.hpp"
 #include "./Glypho/Interpreter.hpp"
+#include "./Glypho/Server.hpp"
 
-int main(int argc, char** argv) {
-    // Check the program arguments
-    if (argc != 2 && argc != 3) {
-        Glypho::Helpers::MUST(false,
+namespace {
+    /**
+     * @brief Run the jobs of a manifest, printing the exit code of each one
+     *
+     * @param arguments The manifest, and the optional results directory
+     * @param engine The engine the programs are run with
+     * @param optimization_level The optimization level
+     */
+    void run_batch(const std::vector<std::string>& arguments,
+                   const Glypho::Engine engine, const int optimization_level) {
+        Glypho::Helpers::MUST(arguments.size() == 1 || arguments.size() == 2,
                               "ArgumentError: Invalid number of arguments\n");
-    }
 
-    // Store the path
-    std::string path(argv[1]);
-    Glypho::Interpreter g_interpreter;
-
-    // Assign the parameters to the interpreter
-    if (argc == 2) {
-        // Base was not provided
-        g_interpreter = Glypho::Interpreter(path);
-    } else {
-        // Try to parse the base
-        int base;
-        try {
-            base = std::stoi(std::string(argv[2]));
-        } catch (std::exception& e) {
-            // Argument was not a number
-            Glypho::Helpers::MUST(false, "ArgumentError: Base '" +
-                                             std::string(argv[2]) +
-                                             "' is not a number\n");
-        }
-
-        // Check if the base is a valid number
-        Glypho::Helpers::MUST(base > 0, "ArgumentError: Base '" +
-                                            std::to_string(base) +
-                                            "' is not a valid number\n");
-
-        // Base was a valid number
-        g_interpreter = Glypho::Interpreter(path, base);
+        // The results are written next to the manifest, by default
+        std::string directory = arguments.size() == 2
+                                    ? arguments[1]
+                                    : arguments[0] + ".results";
+
+        Glypho::Batch batch(arguments[0], engine, optimization_level);
+        batch.run(directory);
+
+        for (auto& job : batch.get_jobs()) {
+            std::cout << job.name << " " << (job.exit_code & 0xFF) << "\n";
+        }
     }
 
-    // Load the program
-    g_interpreter.load_program();
+    /**
+     * @brief Run the interpreter, with the command-line arguments
+     *
+     * @param argc The number of arguments
+     * @param argv The arguments
+     */
+    void run(int argc, char** argv) {
+        // Split the options (--name=value) from the positional arguments
+        std::vector<std::string> arguments;
+        Glypho::Engine engine = Glypho::Engine::Bytecode;
+        int optimization_level = Glypho::Constants::DEFAULT_OPTIMIZATION_LEVEL;
+        bool profile = false;
+        std::string profile_path;
+        bool batch = false;
+        bool serve = false;
+        std::string compile_path;    // Where the compiled program is written
+
+        for (int i = 1; i < argc; ++i) {
+            std::string argument(argv[i]);
+
+            if (argument.size() == 3 && argument.rfind("-O", 0) == 0 &&
+                isdigit(argument[2])) {
+                optimization_level = argument[2] - '0';
+            } else if (argument.rfind("--", 0) != 0) {
+                arguments.push_back(argument);
+            } else if (argument == "--engine=reference") {
+                engine = Glypho::Engine::Reference;
+            } else if (argument == "--engine=bytecode") {
+                engine = Glypho::Engine::Bytecode;
+            } else if (argument == "--engine=cached") {
+                engine = Glypho::Engine::Cached;
+            } else if (argument == "--jit" || argument == "--engine=jit") {
+                engine = Glypho::Engine::Jit;
+            } else if (argument == "--profile") {
+                profile = true;
+            } else if (argument.rfind("--profile=", 0) == 0) {
+                profile = true;
+                profile_path = argument.substr(10);
+            } else if (argument == "--batch") {
+                batch = true;
+            } else if (argument == "--serve") {
+                serve = true;
+            } else if (argument.rfind("--compile=", 0) == 0) {
+                compile_path = argument.substr(10);
+            } else if (argument == "--compile" && i + 1 < argc) {
+                compile_path = argv[++i];
+            } else {
+                Glypho::Helpers::MUST(false, "ArgumentError: Unknown option '" +
+                                                 argument + "'\n");
+            }
+        }
+
+        // The positional argument is the program, that is only compiled
+        if (!compile_path.empty()) {
+            Glypho::Helpers::MUST(
+                !profile && !batch && !serve,
+                "ArgumentError: --compile can not be used with --profile, "
+                "--batch or --serve\n");
+            Glypho::Helpers::MUST(
+                arguments.size() == 1,
+                "ArgumentError: Invalid number of arguments\n");
+
+            Glypho::Interpreter compiler(arguments[0]);
+            compiler.set_engine(Glypho::Engine::Bytecode);
+            compiler.set_optimization_level(optimization_level);
+            compiler.load_program();
+            compiler.save_compiled(compile_path);
+            return;
+        }
+
+        // The positional argument is the path of the socket
+        if (serve) {
+            Glypho::Helpers::MUST(
+                !profile && !batch,
+                "ArgumentError: A server can not be profiled or run a batch\n");
+            Glypho::Helpers::MUST(
+                arguments.size() == 1,
+                "ArgumentError: Invalid number of arguments\n");
+
+            Glypho::Server server(arguments[0], engine, optimization_level);
+            server.run();
+            return;
+        }
+
+        // The positional arguments are the manifest and the results directory
+        if (batch) {
+            Glypho::Helpers::MUST(
+                !profile, "ArgumentError: A batch can not be profiled\n");
+            run_batch(arguments, engine, optimization_level);
+            return;
+        }
+
+        // Check the program arguments
+        if (arguments.size() != 1 && arguments.size() != 2) {
+            Glypho::Helpers::MUST(
+                false, "ArgumentError: Invalid number of arguments\n");
+        }
+
+        // Store the path
+        std::string path(arguments[0]);
+        Glypho::Interpreter g_interpreter;
+
+        // Assign the parameters to the interpreter
+        if (arguments.size() == 1) {
+            // Base was not provided
+            g_interpreter = Glypho::Interpreter(path);
+        } else {
+            // Try to parse the base
+            int base = 0;
+            try {
+                base = std::stoi(arguments[1]);
+            } catch (std::exception& e) {
+                // Argument was not a number
+                Glypho::Helpers::MUST(false, "ArgumentError: Base '" +
+                                                 arguments[1] +
+                                                 "' is not a number\n");
+            }
+
+            // Check if the base is a valid number
+            Glypho::Helpers::MUST(base > 1, "ArgumentError: Base '" +
+                                                std::to_string(base) +
+                                                "' is not a valid number\n");
+
+            // Base was a valid number
+            g_interpreter = Glypho::Interpreter(path, base);
+        }
+        g_interpreter.set_engine(engine);
+        g_interpreter.set_optimization_level(optimization_level);
 
-    // Execute the code
-    g_interpreter.run_program();
+        // The profile is written next to the program, by default
+        if (profile) {
+            g_interpreter.set_profile(profile_path.empty()
+                                          ? path + ".profile.json"
+                                          : profile_path);
+        }
+
+        // Load the program
+        g_interpreter.load_program();
+
+        // Execute the code
+        g_interpreter.run_program();
+    }
+}    // namespace
+
+int main(int argc, char** argv) {
+    // The errors stop the program, after its output is written
+    try {
+        run(argc, argv);
+    } catch (const Glypho::Throwable::Failure& failure) {
+        return Glypho::Diagnostics::report(failure);
+    }
 
     return 0;
 }
@@ -2,7 +2,10 @@
 # credits to AI CG :D
 
 CHECKER_DIR=`dirname $0`/checker
-TEST_SUITE=${@:-test bigtest extra bigextra error exception exceptionextra bonus bigbonus exceptionbonus}
+TEST_SUITE=${@:-test bigtest extra bigextra error exception exceptionextra bonus bigbonus exceptionbonus compiled batch serve}
+# Every suite is run once for each engine and optimization level ("default"
+# runs without options)
+TEST_OPTIONS=${TEST_OPTIONS:-default --engine=reference --engine=cached --jit -O0 -O1 -O3}
 TEST_DIR=$CHECKER_DIR/tests
 LOG_DIR=${CHECKER_DIR}/logs
 INPUT_FILE="code"
@@ -16,104 +19,296 @@ max() {
 }
 
 run_tests (){
-    for suite in ${TEST_SUITE}
+    for option in ${TEST_OPTIONS}
     do
-        for src in `find ${TEST_DIR} -iname "${suite}[0-9]*.gly"`
+        # The results of the other options are named after them
+        if [ "$option" = "default" ]
+        then
+            options=""
+            tag=""
+        else
+            options=$option
+            tag=-`echo $option | tr -d '-' | tr '=' '-'`
+        fi
+
+        for suite in ${TEST_SUITE}
         do
-            test_name=`basename ${src/.gly/}`
-            input=${src/.gly/.in}
-            output=${src/.gly/.out}
-            error=${src/.gly/.err}
-            retval=`cat ${src/.gly/.ret}`
+            for src in `find ${TEST_DIR} -iname "${suite}[0-9]*.gly"`
+            do
+                test_name=`basename ${src/.gly/}`
+                log_name=$test_name$tag
+                input=${src/.gly/.in}
+                output=${src/.gly/.out}
+                error=${src/.gly/.err}
+                retval=`cat ${src/.gly/.ret}`
 
-            OUTPUT_FILE=$test_name.rawout
-            CLEARED_OUTPUT=$test_name.out
-            ERROR_FILE=$test_name.rawerr
-            CLEARED_ERROR=${test_name}.err
+                OUTPUT_FILE=$log_name.rawout
+                CLEARED_OUTPUT=$log_name.out
+                ERROR_FILE=$log_name.rawerr
+                CLEARED_ERROR=${log_name}.err
 
-            if [ -f mytime.cfg ]
-            then
-                time_pref=`grep ^${test_name} mytime.cfg | cut -d ' ' -f 2`
-            fi
-            time=${time_pref:-${time_test}}
-            time=`min ${time} ${TIME_LEFT}`
+                if [ -f mytime.cfg ]
+                then
+                    time_pref=`grep ^${test_name} mytime.cfg | cut -d ' ' -f 2`
+                fi
+                time=${time_pref:-${time_test}}
+                time=`min ${time} ${TIME_LEFT}`
 
-            unset base
-            rm $INPUT_FILE $OUTPUT_FILE $ERROR_FILE $CLEARED_OUTPUT $CLEARED_ERROR &> /dev/null
-            cp ${src} $INPUT_FILE
+                unset base
+                rm $INPUT_FILE $OUTPUT_FILE $ERROR_FILE $CLEARED_OUTPUT $CLEARED_ERROR &> /dev/null
+                cp ${src} $INPUT_FILE
 
-            if [[ $test_name =~ big.* ]]
-            then
-                weight=3
-            else
-                weight=1
-            fi
-            total_score=$[total_score + $weight]
+                if [[ $test_name =~ big.* ]]
+                then
+                    weight=3
+                else
+                    weight=1
+                fi
+                total_score=$[total_score + $weight]
 
-            if [[ "$time" = "0" ]]
-            then
-                echo -e "Skipping \e[1;33m$test_name\e[0m."
-                continue
-            fi
+                if [[ "$time" = "0" ]]
+                then
+                    echo -e "Skipping \e[1;33m$log_name\e[0m."
+                    continue
+                fi
+
+                #echo "Time allowed $time"
+
+                if [[ $test_name =~ .*bonus.* ]]
+                then
+                    base=`grep ^${test_name} ${CHECKER_DIR}/base.cfg | cut -d ' ' -f 2`
+                fi
+
+                # Run the student homework
+                #echo "Running: make -s run input=${src} base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE"
+                START=$(date +%s.%N)
+                timeout $time make -s run options="$options" input=${INPUT_FILE}  base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE
+                timeret=$?
+                END=$(date +%s.%N)
+                DIFF=$(echo "$END - $START" | bc)
+
+                TIME_LEFT=$(max `echo "$TIME_LEFT - $DIFF" | bc` 0)
+
+                if [ $timeret = 124 ]
+                then
+                    echo -e "\e[31mFAILED\e[0m Test \e[1;33m$log_name\e[0m. You failed to win: $weight"
+                    echo "make -s run options=\"$options\" input=${src} base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE" > ${LOG_DIR}/$log_name.command
+                    echo "Timeout $DIFF/$time"
+                    rm ${OUTPUT_FILE} ${CLEARED_OUTPUT} ${CLEARED_ERROR} ${ERROR_FILE} 2>/dev/null
+                else
+                    cat "$OUTPUT_FILE" | grep -vi Makefile > "$CLEARED_OUTPUT"
+                    diff -bBq "$CLEARED_OUTPUT" "${output}" &> /dev/null
+                    outcmp=$?
+
+                    make_error_line=`cat $ERROR_FILE | sed 's/make.* /\nmake: /' | grep ^make`
+                    RETVAL="${make_error_line##* }"
+                    RETVAL="${RETVAL:-0}"
+
+                    cat $ERROR_FILE | sed 's/make.* /\nmake: /' | grep -v ^make > ${CLEARED_ERROR}
+                    diff -bBq "$CLEARED_ERROR" "${error}" &> /dev/null
+                    errcmp=$?
+
+                    if [ "$outcmp" = "0" ] && [ "$errcmp" = "0" ] && [ "$RETVAL" = "$retval" ]
+                    then
+                        echo -e "\e[32mPASSED\e[0m Test \e[1;33m$log_name\e[0m. You won: $weight"
+                        rm ${OUTPUT_FILE} ${CLEARED_OUTPUT} ${CLEARED_ERROR} ${ERROR_FILE} 2>/dev/null
+                        score=$[$score + $weight];
+                    else
+                        echo -e "\e[31mFAILED\e[0m Test $\e[1;33m$log_name\e[0m. You failed to win: $weight"
+                        mv ${OUTPUT_FILE} ${CLEARED_OUTPUT} ${CLEARED_ERROR} ${ERROR_FILE} ${LOG_DIR}
+                        echo ${RETVAL} > ${LOG_DIR}/${log_name}.ret
+                        echo "make -s run options=\"$options\" input=${src} base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE" > ${LOG_DIR}/$log_name.command
+                        echo " failed outputs saved in ${LOG_DIR}"
+                        echo "Output comparison: ${outcmp}, expected 0"
+                        echo "Error comparison: ${errcmp}, expected 0"
+                        echo "Return value comparison: ${RETVAL}, expected ${retval}"
+                    fi
+                fi
+
+                echo "Time left ${TIME_LEFT}"
+            done
+        done
+    done
+}
+
+
+# Checks a result against the expected one, and updates the score
+check_result (){
+    name=$1
+    outcmp=$2
+    errcmp=$3
+    ret=$4
+    expected_ret=$5
+
+    total_score=$[total_score + 1]
+    if [ "$outcmp" = "0" ] && [ "$errcmp" = "0" ] && [ "$ret" = "$expected_ret" ]
+    then
+        echo -e "\e[32mPASSED\e[0m Test \e[1;33m$name\e[0m. You won: 1"
+        score=$[$score + 1];
+    else
+        echo -e "\e[31mFAILED\e[0m Test \e[1;33m$name\e[0m. You failed to win: 1"
+        echo "Output comparison: ${outcmp}, expected 0"
+        echo "Error comparison: ${errcmp}, expected 0"
+        echo "Return value comparison: ${ret}, expected ${expected_ret}"
+    fi
+}
+
+# Compiles some programs (--compile), runs the .glyc files, then feeds the
+# loader corrupted and truncated files
+run_compiled_tests (){
+    work=`mktemp -d`
+
+    for src in `find ${TEST_DIR} -iname "test1[0-9]*.gly" -o -iname "exception0[0-9]*.gly" -o -iname "bonus0[0-9]*.gly" | sort`
+    do
+        test_name=`basename ${src/.gly/}`
+        base=`grep ^${test_name} ${CHECKER_DIR}/base.cfg | cut -d ' ' -f 2`
+        compiled=$work/$test_name.glyc
+
+        ./GlyphoIntepreter --compile $compiled ${src}
+        timeout ${time_test} ./GlyphoIntepreter $compiled $base < ${src/.gly/.in} > $work/out 2> $work/err
+        ret=$?
+
+        diff -bBq $work/out ${src/.gly/.out} &> /dev/null
+        outcmp=$?
+        diff -bBq $work/err ${src/.gly/.err} &> /dev/null
+        errcmp=$?
+        check_result compiled-$test_name $outcmp $errcmp $ret `cat ${src/.gly/.ret}`
+    done
+
+    # A valid file, that is then damaged in different ways
+    valid=$work/valid.glyc
+    ./GlyphoIntepreter --compile $valid `find ${TEST_DIR} -iname "test10*.gly" | head -n 1`
+    size=`stat -c %s $valid`
+    echo "ArgumentError: The compiled program is not valid" > $work/invalid.err
+
+    # Writes bytes (in hex) over a copy of the valid file
+    patch_glyc (){
+        cp $valid $work/$1.glyc
+        echo -n $3 | xxd -r -p | dd of=$work/$1.glyc bs=1 seek=$2 conv=notrunc 2> /dev/null
+    }
+
+    head -c 100 $valid > $work/truncated-header.glyc
+    head -c $[size - 8] $valid > $work/truncated-payload.glyc
+    patch_glyc bad-header-checksum 16 ff
+    patch_glyc bad-payload-checksum $[size - 1] ff
+    patch_glyc wrong-version 8 02000000
+    echo "ArgumentError: The compiled program has version 2, expected 1" > $work/wrong-version.err
 
-            #echo "Time allowed $time"
+    # The count of the first array is too large, and the header checksum is
+    # computed again, so only the bounds of the arrays can reject it
+    cp $valid $work/section-out-of-range.glyc
+    python3 -c "
+import struct, sys
+data = bytearray(open(sys.argv[1], 'rb').read())
+struct.pack_into('<Q', data, 32, 1 << 40)
+checksum = 0xCBF29CE484222325
+for i in range(0, 192, 8):
+    checksum = ((checksum ^ struct.unpack_from('<Q', data, i)[0]) * 0x100000001B3) % (1 << 64)
+    checksum ^= checksum >> 32
+struct.pack_into('<Q', data, 192, checksum)
+open(sys.argv[1], 'wb').write(data)
+" $work/section-out-of-range.glyc
 
+    for name in truncated-header truncated-payload bad-header-checksum bad-payload-checksum wrong-version section-out-of-range
+    do
+        expected=$work/$name.err
+        [ -f $expected ] || expected=$work/invalid.err
+
+        ./GlyphoIntepreter $work/$name.glyc < /dev/null > $work/out 2> $work/err
+        ret=$?
+
+        # Nothing is run
+        [ -s $work/out ]
+        outcmp=$[1 - $?]
+        diff -bBq $work/err $expected &> /dev/null
+        errcmp=$?
+        check_result compiled-$name $outcmp $errcmp $ret 255
+    done
+
+    rm -rf $work
+}
+
+# Runs the tests of the other suites as a single batch (--batch), and
+# compares the results directory with the expected results
+run_batch_tests (){
+    work=`mktemp -d`
+
+    for suite in ${TEST_SUITE}
+    do
+        for src in `find ${TEST_DIR} -iname "${suite}[0-9]*.gly" | sort`
+        do
+            test_name=`basename ${src/.gly/}`
+            unset base
             if [[ $test_name =~ .*bonus.* ]]
             then
                 base=`grep ^${test_name} ${CHECKER_DIR}/base.cfg | cut -d ' ' -f 2`
             fi
+            echo "${src} ${src/.gly/.in} $base" >> $work/manifest
+        done
+    done
+
+    timeout 60 ./GlyphoIntepreter --batch $work/manifest $work/results > /dev/null
+    batchret=$?
+    if [ $batchret != 0 ]
+    then
+        echo -e "\e[31mFAILED\e[0m The batch stopped with ${batchret}"
+    fi
+
+    while read src input base
+    do
+        test_name=`basename ${src/.gly/}`
+        result=$work/results/$test_name
 
-            # Run the student homework
-            #echo "Running: make -s run input=${src} base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE"
-            START=$(date +%s.%N)
-            timeout $time make -s run input=${INPUT_FILE}  base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE
-            timeret=$?
-            END=$(date +%s.%N)
-            DIFF=$(echo "$END - $START" | bc)
+        diff -bBq $result.out ${src/.gly/.out} &> /dev/null
+        outcmp=$?
+        diff -bBq $result.err ${src/.gly/.err} &> /dev/null
+        errcmp=$?
+        check_result batch-$test_name $outcmp $errcmp `cat $result.ret 2> /dev/null` `cat ${src/.gly/.ret}`
+    done < $work/manifest
 
-            TIME_LEFT=$(max `echo "$TIME_LEFT - $DIFF" | bc` 0)
+    rm -rf $work
+}
+
+# Starts a server (--serve), runs the tests of the other suites through
+# glypho-client, and compares the results with the expected ones
+run_serve_tests (){
+    work=`mktemp -d`
+    make -s glypho-client
+
+    ./GlyphoIntepreter --serve $work/socket &
+    server=$!
+    for i in `seq 50`
+    do
+        [ -S $work/socket ] && break
+        sleep 0.1
+    done
 
-            if [ $timeret = 124 ]
+    for suite in ${TEST_SUITE}
+    do
+        for src in `find ${TEST_DIR} -iname "${suite}[0-9]*.gly" | sort`
+        do
+            test_name=`basename ${src/.gly/}`
+            unset base
+            if [[ $test_name =~ .*bonus.* ]]
             then
-                echo -e "\e[31mFAILED\e[0m Test \e[1;33m$test_name\e[0m. You failed to win: $weight"
-                echo "make -s run input=${src} base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE" > ${LOG_DIR}/$test_name.command
-                echo "Timeout $DIFF/$time"
-                rm ${OUTPUT_FILE} ${CLEARED_OUTPUT} ${CLEARED_ERROR} ${ERROR_FILE} 2>/dev/null
-            else
-                cat "$OUTPUT_FILE" | grep -vi Makefile > "$CLEARED_OUTPUT"
-                diff -bBq "$CLEARED_OUTPUT" "${output}" &> /dev/null
-                outcmp=$?
-
-                make_error_line=`cat $ERROR_FILE | sed 's/make.* /\nmake: /' | grep ^make`
-                RETVAL="${make_error_line##* }"
-                RETVAL="${RETVAL:-0}"
-
-                cat $ERROR_FILE | sed 's/make.* /\nmake: /' | grep -v ^make > ${CLEARED_ERROR}
-                diff -bBq "$CLEARED_ERROR" "${error}" &> /dev/null
-                errcmp=$?
-
-                if [ "$outcmp" = "0" ] && [ "$errcmp" = "0" ] && [ "$RETVAL" = "$retval" ]
-                then
-                    echo -e "\e[32mPASSED\e[0m Test \e[1;33m$test_name\e[0m. You won: $weight"
-                    rm ${OUTPUT_FILE} ${CLEARED_OUTPUT} ${CLEARED_ERROR} ${ERROR_FILE} 2>/dev/null
-                    score=$[$score + $weight];
-                else
-                    echo -e "\e[31mFAILED\e[0m Test $\e[1;33m$test_name\e[0m. You failed to win: $weight"
-                    mv ${OUTPUT_FILE} ${CLEARED_OUTPUT} ${CLEARED_ERROR} ${ERROR_FILE} ${LOG_DIR}
-                    echo ${RETVAL} > ${LOG_DIR}/${test_name}.ret
-                    echo "make -s run input=${src} base=$base < ${input} > $OUTPUT_FILE 2> $ERROR_FILE" > ${LOG_DIR}/$test_name.command
-                    echo " failed outputs saved in ${LOG_DIR}"
-                    echo "Output comparison: ${outcmp}, expected 0"
-                    echo "Error comparison: ${errcmp}, expected 0"
-                    echo "Return value comparison: ${RETVAL}, expected ${retval}"
-                fi
+                base=`grep ^${test_name} ${CHECKER_DIR}/base.cfg | cut -d ' ' -f 2`
             fi
 
-            echo "Time left ${TIME_LEFT}"
+            timeout 5 ./glypho-client $work/socket ${src} $base < ${src/.gly/.in} > $work/out 2> $work/err
+            ret=$?
+
+            diff -bBq $work/out ${src/.gly/.out} &> /dev/null
+            outcmp=$?
+            diff -bBq $work/err ${src/.gly/.err} &> /dev/null
+            errcmp=$?
+            check_result serve-$test_name $outcmp $errcmp $ret `cat ${src/.gly/.ret}`
         done
     done
-}
 
+    kill $server
+    wait $server 2> /dev/null
+    rm -rf $work
+}
 
 # Compile student homework
 make build
@@ -139,8 +334,26 @@ else
     time_test="0.75"
 fi
 
+# The time is for every option
+TIME_LEFT=$[TIME_LEFT * `echo ${TEST_OPTIONS} | wc -w`]
+
 run_tests
 
+if [[ " ${TEST_SUITE} " =~ " compiled " ]]
+then
+    run_compiled_tests
+fi
+
+if [[ " ${TEST_SUITE} " =~ " batch " ]]
+then
+    run_batch_tests
+fi
+
+if [[ " ${TEST_SUITE} " =~ " serve " ]]
+then
+    run_serve_tests
+fi
+
 rm $INPUT_FILE &> /dev/null
 #make clean
 